@@ -0,0 +1,888 @@
+/*-------------------------------------------------------------------------
+ *
+ * bench.c
+ *	  benchmark of data loading, sorting, searching and drawing
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/bench.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#if defined HAVE_NCURSESW_CURSES_H
+#include <ncursesw/curses.h>
+#elif defined HAVE_NCURSESW_H
+#include <ncursesw.h>
+#elif defined HAVE_NCURSES_CURSES_H
+#include <ncurses/curses.h>
+#elif defined HAVE_NCURSES_H
+#include <ncurses.h>
+#elif defined HAVE_CURSES_H
+#include <curses.h>
+#else
+/* fallback */
+#include <ncurses/ncurses.h>
+#endif
+
+#include <langinfo.h>
+#include <locale.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "pspg.h"
+#include "themes.h"
+#include "unicode.h"
+
+#define BENCH_WINDOW_ROWS		40
+#define BENCH_WINDOW_COLS		150
+#define BENCH_MAX_FRAMES		1000
+
+/* results for smaller data are not checked against thresholds */
+#define BENCH_CHECK_MIN_ROWS	100000
+
+typedef enum
+{
+	FORMAT_TABLE,
+	FORMAT_EXPANDED,
+	FORMAT_CSV
+} DataFormat;
+
+/*
+ * Synthetic data sets. Every data set has same columns, but different
+ * format.
+ */
+typedef struct
+{
+	const char *name;
+	DataFormat	format;
+	int			border;
+	bool		unicode;			/* unicode linestyle and texts */
+	bool		multiline;			/* every 10th description has two lines */
+} Dataset;
+
+static const Dataset datasets[] = {
+	{"border0-ascii", FORMAT_TABLE, 0, false, false},
+	{"border1-ascii", FORMAT_TABLE, 1, false, false},
+	{"border2-ascii", FORMAT_TABLE, 2, false, false},
+	{"border1-unicode", FORMAT_TABLE, 1, true, false},
+	{"border2-unicode", FORMAT_TABLE, 2, true, false},
+	{"multiline-unicode", FORMAT_TABLE, 2, true, true},
+	{"expanded-ascii", FORMAT_EXPANDED, 1, false, false},
+	{"csv", FORMAT_CSV, 0, false, false},
+	{NULL}
+};
+
+/*
+ * Minimal expected speed in rows per second. The slower result is
+ * reported as regression. The values are a few times lower than results
+ * on usual hardware, so only significant slowdown is reported.
+ */
+static const struct
+{
+	const char *name;
+	double		min_rows_per_sec;
+} thresholds[] = {
+	{"readfile", 200000},
+	{"read_and_format", 100000},
+	{"detect_multilines", 300000},
+	{"sort numeric", 200000},
+	{"sort text", 100000},
+	{"sort two keys", 100000},
+	{"search case sensitive", 2000000},
+	{"search ignore case", 1000000},
+	{"search ignore lower case", 1000000},
+	{"search index", 1000000},
+	{"filter text", 1000000},
+	{"filter column pattern", 500000},
+	{"filter numeric", 2000000},
+	{"window_fill", 8000},
+	{"window_fill hscroll", 8000},
+	{NULL}
+};
+
+#define COLUMNS			5
+#define COL_ID			0
+#define COL_NUM			1
+#define COL_NAME		2
+#define COL_DESCR		3
+#define COL_FLAG		4
+
+static const char *column_names[COLUMNS] = {"id", "num", "name", "descr", "flag"};
+static bool column_right_align[COLUMNS] = {true, true, false, false, false};
+static int	column_widths[COLUMNS];
+
+static const char *ascii_words[] = {
+	"alpha", "beta", "gamma", "delta", "epsilon",
+	"zeta", "theta", "kappa", "lambda", "sigma"
+};
+
+static const char *unicode_words[] = {
+	"příliš", "žluťoučký", "kůň", "úpěl", "ďábelské",
+	"ódy", "日本語", "Ωmega", "straße", "ёлка"
+};
+
+static unsigned int random_state;
+static bool checked_regression = false;
+
+static unsigned int
+bench_random(void)
+{
+	random_state = random_state * 1103515245 + 12345;
+
+	return (random_state >> 16) & 0x7fff;
+}
+
+static double
+time_diff(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1.0e9;
+}
+
+/*
+ * Prints result and checks it against threshold. Returns false, when
+ * the speed is lower than expected.
+ */
+static bool
+report(const char *dataset, int nrows, const char *name, long rows, long bytes, double sec)
+{
+	double		rows_per_sec = sec > 0 ? rows / sec : 0;
+	const char *status = "";
+	int			i;
+
+	for (i = 0; thresholds[i].name; i++)
+	{
+		if (strcmp(thresholds[i].name, name) == 0)
+		{
+			if (nrows >= BENCH_CHECK_MIN_ROWS && sec > 0)
+			{
+				checked_regression = true;
+
+				if (rows_per_sec < thresholds[i].min_rows_per_sec)
+					status = "REGRESSION";
+				else
+					status = "ok";
+			}
+			break;
+		}
+	}
+
+	printf("%-18s %9d  %-25s %10.4f s %12.0f rows/s",
+		   dataset, nrows, name, sec, rows_per_sec);
+
+	if (bytes > 0)
+		printf(" %9.1f MB/s", sec > 0 ? bytes / sec / (1024 * 1024) : 0.0);
+	else
+		printf(" %14s", "");
+
+	printf("  %s\n", status);
+	fflush(stdout);
+
+	return strcmp(status, "REGRESSION") != 0;
+}
+
+/*
+ * Generator of synthetic data
+ */
+static void
+gen_values(const Dataset *ds, int rowno, char values[COLUMNS][128])
+{
+	const char **words = ds->unicode ? unicode_words : ascii_words;
+	int			nwords = 2 + bench_random() % 3;
+	int			i;
+
+	snprintf(values[COL_ID], 128, "%d", rowno + 1);
+	snprintf(values[COL_NUM], 128, "%d.%02d",
+			 (int) (bench_random() % 1000), (int) (bench_random() % 100));
+	snprintf(values[COL_NAME], 128, "%s_%d",
+			 words[bench_random() % 10], (int) (bench_random() % 1000));
+
+	values[COL_DESCR][0] = '\0';
+	for (i = 0; i < nwords; i++)
+	{
+		if (i > 0)
+			strcat(values[COL_DESCR], (ds->multiline && rowno % 10 == 0 && i == 1) ? "\n" : " ");
+		strcat(values[COL_DESCR], words[bench_random() % 10]);
+	}
+
+	/* rare patterns for searching */
+	if (rowno % 1000 == 0)
+		strcat(values[COL_DESCR], " needle");
+	else if (rowno % 1000 == 500)
+		strcat(values[COL_DESCR], " NEEDLE");
+
+	snprintf(values[COL_FLAG], 128, "%s", bench_random() % 2 ? "t" : "f");
+}
+
+static void
+set_column_widths(int nrows)
+{
+	char		buffer[20];
+
+	snprintf(buffer, sizeof(buffer), "%d", nrows);
+
+	column_widths[COL_ID] = strlen(buffer) > 2 ? strlen(buffer) : 2;
+	column_widths[COL_NUM] = 6;
+	column_widths[COL_NAME] = 13;
+	column_widths[COL_DESCR] = 43;
+	column_widths[COL_FLAG] = 4;
+}
+
+static void
+put_repeated(FILE *fp, const char *str, int n)
+{
+	while (n-- > 0)
+		fputs(str, fp);
+}
+
+/*
+ * Writes one line of value aligned to width. Returns pointer to next line
+ * of value or NULL.
+ */
+static const char *
+put_value(FILE *fp, const char *value, int width, bool right_align)
+{
+	const char *end = strchr(value, '\n');
+	int			size = end ? end - value : (int) strlen(value);
+	int			spaces = width - utf_string_dsplen(value, size);
+
+	if (right_align)
+		put_repeated(fp, " ", spaces);
+
+	fwrite(value, 1, size, fp);
+
+	if (!right_align)
+		put_repeated(fp, " ", spaces);
+
+	return end ? end + 1 : NULL;
+}
+
+/*
+ * Writes horizontal border line. The type is 't' top, 'h' header
+ * separator or 'b' bottom line.
+ */
+static void
+put_border_line(FILE *fp, const Dataset *ds, char type)
+{
+	const char *hchr = ds->unicode ? (type == 'h' && ds->border == 2 ? "═" : "─") : "-";
+	const char *left,
+			   *cross,
+			   *right;
+	int			i;
+
+	if (ds->unicode)
+	{
+		if (type == 't')
+		{
+			left = "┌"; cross = "┬"; right = "┐";
+		}
+		else if (type == 'h')
+		{
+			left = "╞"; cross = ds->border == 2 ? "╪" : "┼"; right = "╡";
+		}
+		else
+		{
+			left = "└"; cross = "┴"; right = "┘";
+		}
+	}
+	else
+	{
+		left = "+"; cross = "+"; right = "+";
+	}
+
+	if (ds->border == 2)
+		fputs(left, fp);
+
+	for (i = 0; i < COLUMNS; i++)
+	{
+		if (i > 0)
+			fputs(ds->border == 0 ? " " : cross, fp);
+
+		put_repeated(fp, hchr, column_widths[i] + (ds->border > 0 ? 2 : 0));
+	}
+
+	if (ds->border == 2)
+		fputs(right, fp);
+
+	fputc('\n', fp);
+}
+
+/*
+ * Writes one row of table in psql format. Multiline values are written
+ * to more lines, with marker of continuation.
+ */
+static void
+put_table_row(FILE *fp, const Dataset *ds, const char **values, bool is_header)
+{
+	const char *vchr = ds->unicode ? "│" : "|";
+	const char *lines[COLUMNS];
+	bool		has_more = true;
+	int			i;
+
+	for (i = 0; i < COLUMNS; i++)
+		lines[i] = values[i];
+
+	while (has_more)
+	{
+		has_more = false;
+
+		if (ds->border == 2)
+			fputs(vchr, fp);
+
+		for (i = 0; i < COLUMNS; i++)
+		{
+			const char *value = lines[i] ? lines[i] : "";
+			const char *next;
+
+			if (i > 0)
+				fputs(ds->border == 0 ? " " : vchr, fp);
+
+			if (ds->border > 0)
+				fputc(' ', fp);
+
+			if (is_header)
+			{
+				int		spaces = column_widths[i] - utf_string_dsplen(value, strlen(value));
+
+				put_repeated(fp, " ", spaces / 2);
+				fputs(value, fp);
+				put_repeated(fp, " ", spaces - spaces / 2);
+				next = NULL;
+			}
+			else
+				next = put_value(fp, value, column_widths[i], column_right_align[i]);
+
+			if (ds->border > 0)
+				fputs(next ? (ds->unicode ? "↵" : "+") : " ", fp);
+
+			lines[i] = next;
+			if (next)
+				has_more = true;
+		}
+
+		if (ds->border == 2)
+			fputs(vchr, fp);
+
+		fputc('\n', fp);
+	}
+}
+
+static void
+gen_file(const char *path, const Dataset *ds, int nrows)
+{
+	FILE	   *fp;
+	char		values[COLUMNS][128];
+	const char *ptrs[COLUMNS];
+	int			i, j;
+
+	fp = fopen(path, "w");
+	if (!fp)
+	{
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	random_state = 1;
+	set_column_widths(nrows);
+
+	for (j = 0; j < COLUMNS; j++)
+		ptrs[j] = values[j];
+
+	if (ds->format == FORMAT_CSV)
+	{
+		fprintf(fp, "id,num,name,descr,flag\n");
+
+		for (i = 0; i < nrows; i++)
+		{
+			gen_values(ds, i, values);
+			fprintf(fp, "%s,%s,%s,%s,%s\n",
+					values[0], values[1], values[2], values[3], values[4]);
+		}
+	}
+	else if (ds->format == FORMAT_EXPANDED)
+	{
+		for (i = 0; i < nrows; i++)
+		{
+			char		header[40];
+			int			size;
+
+			gen_values(ds, i, values);
+
+			size = snprintf(header, sizeof(header), "-[ RECORD %d ]", i + 1);
+			fputs(header, fp);
+			if (size < 6)
+				put_repeated(fp, "-", 6 - size);
+			fputc('+', fp);
+			put_repeated(fp, "-", column_widths[COL_DESCR] + 1);
+			fputc('\n', fp);
+
+			for (j = 0; j < COLUMNS; j++)
+			{
+				put_value(fp, column_names[j], 5, false);
+				fprintf(fp, " | %s\n", values[j]);
+			}
+		}
+	}
+	else
+	{
+		if (ds->border == 2)
+			put_border_line(fp, ds, 't');
+
+		put_table_row(fp, ds, column_names, true);
+		put_border_line(fp, ds, 'h');
+
+		for (i = 0; i < nrows; i++)
+		{
+			gen_values(ds, i, values);
+			put_table_row(fp, ds, ptrs, false);
+		}
+
+		if (ds->border == 2)
+			put_border_line(fp, ds, 'b');
+
+		fprintf(fp, "(%d rows)\n\n", nrows);
+	}
+
+	fclose(fp);
+}
+
+/*
+ * Prepares loaded data like pspg does before displaying
+ */
+static void
+prepare_desc(Options *opts, DataDesc *desc)
+{
+	if (desc->headline_transl != NULL && !desc->is_expanded_mode)
+	{
+		if (desc->border_head_row != -1)
+			desc->first_data_row = desc->border_head_row + 1;
+	}
+	else if (desc->title_rows > 0 && desc->is_expanded_mode)
+		desc->first_data_row = desc->title_rows;
+	else
+	{
+		desc->first_data_row = 0;
+		desc->last_data_row = desc->last_row;
+		desc->title_rows = 0;
+		desc->title[0] = '\0';
+	}
+
+	trim_footer_rows(opts, desc);
+}
+
+static long
+data_bytes(DataDesc *desc)
+{
+	LineBuffer *lnb = &desc->rows;
+	long		bytes = 0;
+	int			i;
+
+	while (lnb)
+	{
+		for (i = 0; i < lnb->nrows; i++)
+			bytes += strlen(lnb->rows[i]);
+
+		lnb = lnb->next;
+	}
+
+	return bytes;
+}
+
+static bool
+bench_search(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+			 const char *dsname, int nrows,
+			 const char *name, const char *pattern,
+			 bool ignore_case, bool ignore_lower_case)
+{
+	struct timespec start;
+	LineBuffer *lnb = &desc->rows;
+	long		found = 0;
+	long		rows = 0;
+	int			i;
+	bool		result;
+
+	opts->ignore_case = ignore_case;
+	opts->ignore_lower_case = ignore_lower_case;
+
+	strcpy(scrdesc->searchterm, pattern);
+	scrdesc->searchterm_size = strlen(pattern);
+	scrdesc->searchterm_char_size = utf8len(scrdesc->searchterm);
+	scrdesc->has_upperchr = has_upperchr(opts, scrdesc->searchterm);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (lnb)
+	{
+		for (i = 0; i < lnb->nrows; i++)
+		{
+			const char *rowstr = lnb->rows[i];
+			const char *str = rowstr;
+			int			match_size;
+
+			while ((str = pspg_search(opts, scrdesc, desc, lnb, i, rowstr, str, &match_size)) != NULL)
+			{
+				found += 1;
+				str += match_size > 0 ? match_size : 1;
+			}
+
+			rows += 1;
+		}
+
+		lnb = lnb->next;
+	}
+
+	result = report(dsname, nrows, name, rows, data_bytes(desc), time_diff(&start));
+
+	opts->ignore_case = false;
+	opts->ignore_lower_case = false;
+
+	scrdesc->searchterm[0] = '\0';
+	scrdesc->searchterm_size = 0;
+	scrdesc->searchterm_char_size = 0;
+
+	/* searching should to find inserted patterns */
+	if (found == 0)
+	{
+		fprintf(stderr, "%s: pattern \"%s\" was not found\n", dsname, pattern);
+		return false;
+	}
+
+	return result;
+}
+
+/*
+ * Builds the index of all occurrences of pattern by same chunks of rows,
+ * that are processed by pager, when no key is pressed.
+ */
+static bool
+bench_search_index(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				   const char *dsname, int nrows,
+				   const char *name, const char *pattern)
+{
+	struct timespec start;
+	SearchIndex *si;
+	bool		result;
+
+	strcpy(scrdesc->searchterm, pattern);
+	scrdesc->searchterm_size = strlen(pattern);
+	scrdesc->searchterm_char_size = utf8len(scrdesc->searchterm);
+	scrdesc->has_upperchr = has_upperchr(opts, scrdesc->searchterm);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!search_index_scan(opts, scrdesc, desc, SEARCH_INDEX_SCAN_ROWS))
+		;
+
+	result = report(dsname, nrows, name, desc->total_rows, data_bytes(desc), time_diff(&start));
+
+	si = get_search_index(opts, scrdesc, desc);
+
+	/* searching should to find inserted patterns */
+	if (si->nmatches == 0)
+	{
+		fprintf(stderr, "%s: pattern \"%s\" was not indexed\n", dsname, pattern);
+		result = false;
+	}
+
+	free_search_index(desc);
+
+	scrdesc->searchterm[0] = '\0';
+	scrdesc->searchterm_size = 0;
+	scrdesc->searchterm_char_size = 0;
+
+	return result;
+}
+
+static bool
+bench_filter(Options *opts, DataDesc *desc,
+			 const char *dsname, int nrows,
+			 const char *name, const char *expr)
+{
+	struct timespec start;
+	char		errbuf[256];
+	bool		result;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (!apply_filter(opts, desc, expr, errbuf, sizeof(errbuf)))
+	{
+		fprintf(stderr, "%s: cannot use filter \"%s\": %s\n", dsname, expr, errbuf);
+		return false;
+	}
+
+	result = report(dsname, nrows, name, desc->nrecords, 0, time_diff(&start));
+
+	if (desc->nvisible_records == 0)
+	{
+		fprintf(stderr, "%s: filter \"%s\" hides all records\n", dsname, expr);
+		result = false;
+	}
+
+	free_filter(desc);
+
+	return result;
+}
+
+static bool
+bench_window_fill(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				  const char *dsname, int nrows,
+				  const char *name, int srcx)
+{
+	struct timespec start;
+	int			srcy;
+	int			frames = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (srcy = desc->first_data_row;
+		 srcy <= desc->last_row && frames < BENCH_MAX_FRAMES;
+		 srcy += BENCH_WINDOW_ROWS)
+	{
+		/* every frame is drawn fully */
+		memset(scrdesc->fill_state, 0, sizeof(scrdesc->fill_state));
+
+		window_fill(WINDOW_ROWS, srcy, srcx, 5, -1, -1, desc, scrdesc, opts);
+		wnoutrefresh(w_rows(scrdesc));
+		doupdate();
+
+		frames += 1;
+	}
+
+	return report(dsname, nrows, name, (long) frames * BENCH_WINDOW_ROWS, 0, time_diff(&start));
+}
+
+static bool
+bench_dataset(Options *opts, const char *dir, const Dataset *ds, int nrows, bool use_ncurses)
+{
+	char		path[1024];
+	struct stat	st;
+	struct timespec start;
+	DataDesc	desc;
+	ScrDesc		scrdesc;
+	FILE	   *fp;
+	bool		result = true;
+
+	snprintf(path, sizeof(path), "%s/%s-%d.%s", dir, ds->name, nrows,
+			 ds->format == FORMAT_CSV ? "csv" : "txt");
+
+	gen_file(path, ds, nrows);
+
+	if (stat(path, &st) != 0)
+	{
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	fp = fopen(path, "r");
+	if (!fp)
+	{
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&desc, 0, sizeof(DataDesc));
+	memset(&scrdesc, 0, sizeof(ScrDesc));
+
+	opts->pathname = path;
+
+	if (ds->format == FORMAT_CSV)
+	{
+		const char *err;
+
+		opts->csv_format = true;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if (!read_and_format(fp, opts, &desc, &err))
+		{
+			fprintf(stderr, "%s: %s\n", path, err);
+			exit(EXIT_FAILURE);
+		}
+
+		result &= report(ds->name, nrows, "read_and_format", nrows, st.st_size, time_diff(&start));
+
+		opts->csv_format = false;
+	}
+	else
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		readfile(fp, opts, &desc);
+		result &= report(ds->name, nrows, "readfile", desc.total_rows, st.st_size, time_diff(&start));
+	}
+
+	fclose(fp);
+	unlink(path);
+
+	if (desc.headline)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		(void) translate_headline(opts, &desc);
+		result &= report(ds->name, nrows, "translate_headline", 1, desc.headline_size, time_diff(&start));
+	}
+
+	prepare_desc(opts, &desc);
+
+	if (!desc.is_expanded_mode)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		detect_multilines(opts, &desc);
+		result &= report(ds->name, nrows, "detect_multilines", desc.total_rows, 0, time_diff(&start));
+	}
+
+	if (desc.columns == COLUMNS && !desc.is_expanded_mode)
+	{
+		SortKey		key;
+		SortKey		keys[2];
+
+		key.desc = false;
+
+		key.column = COL_NUM + 1;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		update_order_map(opts, &scrdesc, &desc, &key, 1, 0);
+		result &= report(ds->name, nrows, "sort numeric", nrows, 0, time_diff(&start));
+
+		key.column = COL_DESCR + 1;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		update_order_map(opts, &scrdesc, &desc, &key, 1, 0);
+		result &= report(ds->name, nrows, "sort text", nrows, 0, time_diff(&start));
+
+		/* rows with same flag are ordered by numeric column descending */
+		keys[0].column = COL_FLAG + 1;
+		keys[0].desc = false;
+		keys[1].column = COL_NUM + 1;
+		keys[1].desc = true;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		update_order_map(opts, &scrdesc, &desc, keys, 2, 0);
+		result &= report(ds->name, nrows, "sort two keys", nrows, 0, time_diff(&start));
+
+		/* back to original order */
+		update_order_map(opts, &scrdesc, &desc, NULL, 0, 0);
+
+		result &= bench_filter(opts, &desc, ds->name, nrows,
+							   "filter text", "needle");
+		result &= bench_filter(opts, &desc, ds->name, nrows,
+							   "filter column pattern", "name ~ _99");
+		result &= bench_filter(opts, &desc, ds->name, nrows,
+							   "filter numeric", "num > 500");
+	}
+
+	result &= bench_search(opts, &scrdesc, &desc, ds->name, nrows,
+						   "search case sensitive", "needle", false, false);
+	result &= bench_search(opts, &scrdesc, &desc, ds->name, nrows,
+						   "search ignore case", "needle", true, false);
+	result &= bench_search(opts, &scrdesc, &desc, ds->name, nrows,
+						   "search ignore lower case", "Needle", false, true);
+	result &= bench_search_index(opts, &scrdesc, &desc, ds->name, nrows,
+								 "search index", "needle");
+
+	if (use_ncurses)
+	{
+		w_rows(&scrdesc) = newwin(BENCH_WINDOW_ROWS, BENCH_WINDOW_COLS, 0, 0);
+		initialize_theme(opts->theme, WINDOW_ROWS, desc.headline_transl != NULL, false,
+						 &scrdesc.themes[WINDOW_ROWS]);
+
+		result &= bench_window_fill(opts, &scrdesc, &desc, ds->name, nrows, "window_fill", 0);
+		result &= bench_window_fill(opts, &scrdesc, &desc, ds->name, nrows, "window_fill hscroll", 30);
+
+		delwin(w_rows(&scrdesc));
+	}
+
+	DataDescFree(&desc);
+
+	return result;
+}
+
+/*
+ * Usage: pspg-bench [rows ...]
+ *
+ * For every size (default 10000 and 1000000 rows) the synthetic data
+ * sets are generated to temporary directory, and the main routines are
+ * measured. Returns 1, when some result is slower than threshold.
+ */
+int
+main(int argc, char *argv[])
+{
+	char		dir[] = "/tmp/pspg-bench-XXXXXX";
+	Options		opts;
+	FILE	   *devnull_out = NULL;
+	FILE	   *devnull_in = NULL;
+	bool		use_ncurses = false;
+	bool		result = true;
+	int			default_sizes[] = {10000, 1000000};
+	int			nsizes;
+	int			i, j;
+
+	setlocale(LC_ALL, "");
+	if (strcmp(nl_langinfo(CODESET), "UTF-8") != 0)
+		setlocale(LC_ALL, "C.UTF-8");
+
+	memset(&opts, 0, sizeof(Options));
+	opts.theme = 1;
+	opts.freezed_cols = -1;
+	opts.csv_separator = -1;
+	opts.border_type = 2;
+	opts.force8bit = strcmp(nl_langinfo(CODESET), "UTF-8") != 0;
+
+	if (!mkdtemp(dir))
+	{
+		perror("cannot to create temporary directory");
+		exit(EXIT_FAILURE);
+	}
+
+	/* window_fill is measured against terminal, that writes to /dev/null */
+	devnull_out = fopen("/dev/null", "w");
+	devnull_in = fopen("/dev/null", "r");
+
+	if (devnull_out && devnull_in && newterm("xterm-256color", devnull_out, devnull_in) != NULL)
+	{
+		resize_term(BENCH_WINDOW_ROWS, BENCH_WINDOW_COLS);
+		start_color();
+		initialize_color_pairs(opts.theme, false, false);
+		use_ncurses = true;
+	}
+	else
+		fprintf(stderr, "cannot to initialize ncurses terminal, window_fill is not measured\n");
+
+	nsizes = argc > 1 ? argc - 1 : (int) (sizeof(default_sizes) / sizeof(int));
+
+	printf("%-18s %9s  %-25s %12s %19s %14s\n",
+		   "data set", "rows", "benchmark", "time", "speed", "bandwidth");
+
+	for (i = 0; i < nsizes; i++)
+	{
+		int		nrows = argc > 1 ? atoi(argv[i + 1]) : default_sizes[i];
+
+		if (nrows <= 0)
+		{
+			fprintf(stderr, "invalid number of rows \"%s\"\n", argv[i + 1]);
+			exit(EXIT_FAILURE);
+		}
+
+		for (j = 0; datasets[j].name; j++)
+			result &= bench_dataset(&opts, dir, &datasets[j], nrows, use_ncurses);
+	}
+
+	if (use_ncurses)
+		endwin();
+
+	rmdir(dir);
+
+	if (!checked_regression)
+		printf("\nresults were not checked (data sets are smaller than %d rows)\n",
+			   BENCH_CHECK_MIN_ROWS);
+	else if (!result)
+		printf("\nsome results are slower than expected\n");
+
+	return result ? 0 : 1;
+}
@@ -0,0 +1,537 @@
+/*-------------------------------------------------------------------------
+ *
+ * bookmarks.c
+ *	  ordered index of bookmarks and saving of bookmarks per file
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/bookmarks.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pspg.h"
+
+/*
+ * Max number of files with saved bookmarks. Bookmarks of files, that
+ * were not used for long time, are removed.
+ */
+#define MAX_BOOKMARKED_FILES		100
+
+/*
+ * Bookmarks are marked in bitmaps of LineBuffers (used for drawing) and
+ * they are stored in array sorted by number of row in input (used for
+ * navigation). When order map is used, then the positions of bookmarks
+ * in order map are collected once, and they are used until order map
+ * is changed.
+ */
+
+/*
+ * Returns index of first item of sorted array, that is not less than value
+ */
+static int
+lower_bound(int *values, int nvalues, int value)
+{
+	int			lo = 0;
+	int			hi = nvalues;
+
+	while (lo < hi)
+	{
+		int		mid = (lo + hi) / 2;
+
+		if (values[mid] < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int
+lower_bound_bookmark(Bookmark *bookmarks, int nbookmarks, int rowno)
+{
+	int			lo = 0;
+	int			hi = nbookmarks;
+
+	while (lo < hi)
+	{
+		int		mid = (lo + hi) / 2;
+
+		if (bookmarks[mid].rowno < rowno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void
+set_bookmark_flag(LineBuffer *lnb, int lnb_row, bool set)
+{
+	if (!lnb->bookmarks)
+	{
+		if (!set)
+			return;
+
+		lnb->bookmarks = malloc(LINEINFO_BITMAP_SIZE);
+		if (!lnb->bookmarks)
+			leave_ncurses("out of memory");
+
+		mem_alloc(MEM_LINEINFO, LINEINFO_BITMAP_SIZE);
+
+		memset(lnb->bookmarks, 0, LINEINFO_BITMAP_SIZE);
+	}
+
+	if (set)
+		LINEINFO_SET(lnb->bookmarks, lnb_row);
+	else
+		LINEINFO_CLEAR(lnb->bookmarks, lnb_row);
+}
+
+/*
+ * Add bookmark to sorted array. The array of positions has same size
+ * like array of bookmarks.
+ */
+static void
+add_bookmark(DataDesc *desc, int pos, LineBuffer *lnb, int lnb_row)
+{
+	Bookmark   *bm;
+
+	if (desc->nbookmarks == desc->bookmarks_size)
+	{
+		int		size = desc->bookmarks_size > 0 ? desc->bookmarks_size * 2 : 16;
+
+		desc->bookmarks = realloc(desc->bookmarks, size * sizeof(Bookmark));
+		desc->bookmark_positions = realloc(desc->bookmark_positions, size * sizeof(int));
+		if (!desc->bookmarks || !desc->bookmark_positions)
+			leave_ncurses("out of memory");
+
+		mem_free(MEM_LINEINFO, desc->bookmarks_size * (sizeof(Bookmark) + sizeof(int)));
+		mem_alloc(MEM_LINEINFO, size * (sizeof(Bookmark) + sizeof(int)));
+
+		desc->bookmarks_size = size;
+	}
+
+	memmove(&desc->bookmarks[pos + 1], &desc->bookmarks[pos],
+			(desc->nbookmarks - pos) * sizeof(Bookmark));
+
+	bm = &desc->bookmarks[pos];
+	bm->rowno = lnb->first_row + lnb_row;
+	bm->lnb = lnb;
+	bm->lnb_row = lnb_row;
+
+	desc->nbookmarks += 1;
+}
+
+/*
+ * Switch bookmark on row displayed on position "position"
+ */
+void
+toggle_bookmark(DataDesc *desc, LineBuffer *lnb, int lnb_row, int position)
+{
+	int			rowno = lnb->first_row + lnb_row;
+	int			pos;
+	bool		is_bookmark;
+
+	pos = lower_bound_bookmark(desc->bookmarks, desc->nbookmarks, rowno);
+	is_bookmark = pos < desc->nbookmarks && desc->bookmarks[pos].rowno == rowno;
+
+	if (is_bookmark)
+	{
+		memmove(&desc->bookmarks[pos], &desc->bookmarks[pos + 1],
+				(desc->nbookmarks - pos - 1) * sizeof(Bookmark));
+		desc->nbookmarks -= 1;
+	}
+	else
+		add_bookmark(desc, pos, lnb, lnb_row);
+
+	set_bookmark_flag(lnb, lnb_row, !is_bookmark);
+
+	/* update positions in order map */
+	if (desc->bookmark_positions_valid)
+	{
+		int	   *positions = desc->bookmark_positions;
+
+		pos = lower_bound(positions, desc->nbookmark_positions, position);
+
+		if (is_bookmark)
+		{
+			if (pos < desc->nbookmark_positions && positions[pos] == position)
+			{
+				memmove(&positions[pos], &positions[pos + 1],
+						(desc->nbookmark_positions - pos - 1) * sizeof(int));
+				desc->nbookmark_positions -= 1;
+			}
+		}
+		else
+		{
+			memmove(&positions[pos + 1], &positions[pos],
+					(desc->nbookmark_positions - pos) * sizeof(int));
+			positions[pos] = position;
+			desc->nbookmark_positions += 1;
+		}
+	}
+
+	desc->bookmarks_changed = true;
+}
+
+/*
+ * Remove all bookmarks
+ */
+void
+flush_bookmarks(DataDesc *desc)
+{
+	int			i;
+
+	for (i = 0; i < desc->nbookmarks; i++)
+		set_bookmark_flag(desc->bookmarks[i].lnb, desc->bookmarks[i].lnb_row, false);
+
+	if (desc->nbookmarks > 0)
+		desc->bookmarks_changed = true;
+
+	desc->nbookmarks = 0;
+	desc->nbookmark_positions = 0;
+}
+
+/*
+ * Positions of bookmarks should be searched again after change of order map.
+ */
+void
+invalidate_bookmark_positions(DataDesc *desc)
+{
+	desc->bookmark_positions_valid = false;
+}
+
+/*
+ * Collects sorted positions of bookmarked rows in order map. Bookmarked
+ * rows hidden by filter are not there.
+ */
+static void
+prepare_bookmark_positions(DataDesc *desc)
+{
+	int			nrows = desc->total_rows - desc->hidden_rows;
+	int			i;
+
+	desc->nbookmark_positions = 0;
+
+	for (i = 0; i < nrows && desc->nbookmark_positions < desc->nbookmarks; i++)
+	{
+		MappedLine *mp = &desc->order_map[i];
+
+		if (mp->lnb->bookmarks && LINEINFO_IS_SET(mp->lnb->bookmarks, mp->lnb_row))
+			desc->bookmark_positions[desc->nbookmark_positions++] = i;
+	}
+
+	desc->bookmark_positions_valid = true;
+}
+
+/*
+ * Returns displayed position of nearest bookmark after (or before, when
+ * backward is true) position, or -1 when there is not any bookmark.
+ */
+int
+find_bookmark(DataDesc *desc, int position, bool backward)
+{
+	int			pos;
+
+	if (desc->nbookmarks == 0)
+		return -1;
+
+	if (desc->order_map)
+	{
+		int	   *positions;
+
+		if (!desc->bookmark_positions_valid)
+			prepare_bookmark_positions(desc);
+
+		positions = desc->bookmark_positions;
+
+		if (backward)
+		{
+			pos = lower_bound(positions, desc->nbookmark_positions, position) - 1;
+			return pos >= 0 ? positions[pos] : -1;
+		}
+
+		pos = lower_bound(positions, desc->nbookmark_positions, position + 1);
+		return pos < desc->nbookmark_positions ? positions[pos] : -1;
+	}
+
+	/* without order map, the position is number of row */
+	if (backward)
+	{
+		pos = lower_bound_bookmark(desc->bookmarks, desc->nbookmarks, position) - 1;
+		return pos >= 0 ? desc->bookmarks[pos].rowno : -1;
+	}
+
+	pos = lower_bound_bookmark(desc->bookmarks, desc->nbookmarks, position + 1);
+	return pos < desc->nbookmarks ? desc->bookmarks[pos].rowno : -1;
+}
+
+void
+free_bookmarks(DataDesc *desc)
+{
+	free(desc->bookmarks);
+	free(desc->bookmark_positions);
+
+	mem_free(MEM_LINEINFO, desc->bookmarks_size * (sizeof(Bookmark) + sizeof(int)));
+
+	desc->bookmarks = NULL;
+	desc->bookmark_positions = NULL;
+	desc->nbookmarks = 0;
+	desc->nbookmark_positions = 0;
+	desc->bookmarks_size = 0;
+	desc->bookmark_positions_valid = false;
+}
+
+/*
+ * Bookmarks are saved in file with one line per data file. The line holds
+ * size and modification time of data file, comma separated numbers of
+ * bookmarked rows and full path of data file (separated by spaces). When
+ * the data file was changed, then saved bookmarks are ignored.
+ */
+static char *
+full_path(const char *pathname)
+{
+	char	   *result = realpath(pathname, NULL);
+
+	if (!result)
+		result = strdup(pathname);
+
+	return result;
+}
+
+/*
+ * Returns pointer to list of rows and to path of data file of line of
+ * bookmarks file, or false, when the line has not expected format.
+ */
+static bool
+parse_line(const char *line, long *size, long *mtime, const char **rows, const char **path)
+{
+	const char *ptr = line;
+	char	   *end;
+
+	*size = strtol(ptr, &end, 10);
+	if (end == ptr || *end != ' ')
+		return false;
+
+	ptr = end + 1;
+	*mtime = strtol(ptr, &end, 10);
+	if (end == ptr || *end != ' ')
+		return false;
+
+	*rows = end + 1;
+
+	ptr = strchr(*rows, ' ');
+	if (!ptr)
+		return false;
+
+	*path = ptr + 1;
+
+	return true;
+}
+
+/*
+ * Returns true, when the line of bookmarks file is related to file "path"
+ */
+static bool
+is_line_of_file(const char *line, const char *path)
+{
+	long		size, mtime;
+	const char *rows, *_path;
+
+	return parse_line(line, &size, &mtime, &rows, &_path) && strcmp(_path, path) == 0;
+}
+
+/*
+ * Load saved bookmarks of file "pathname". Rows out of data are ignored.
+ * The size and modification time of file are stored, and bookmarks are
+ * saved with them.
+ */
+void
+load_bookmarks(DataDesc *desc, const char *bookmarks_path, const char *pathname)
+{
+	FILE	   *fp;
+	struct stat	st;
+	char	   *path;
+	char	   *line = NULL;
+	size_t		len = 0;
+	ssize_t		read;
+
+	if (stat(pathname, &st) != 0)
+		return;
+
+	desc->bookmarks_file_size = (long) st.st_size;
+	desc->bookmarks_file_mtime = (long) st.st_mtime;
+
+	fp = fopen(bookmarks_path, "r");
+	if (!fp)
+		return;
+
+	path = full_path(pathname);
+	if (!path)
+		leave_ncurses("out of memory");
+
+	while ((read = getline(&line, &len, fp)) != -1)
+	{
+		LineBuffer *lnb = &desc->rows;
+		const char *ptr;
+		const char *_path;
+		long		size, mtime;
+
+		if (read > 0 && line[read - 1] == '\n')
+			line[read - 1] = '\0';
+
+		if (!parse_line(line, &size, &mtime, &ptr, &_path) ||
+			strcmp(_path, path) != 0)
+			continue;
+
+		/* the file was changed, and bookmarks are not valid */
+		if (size != desc->bookmarks_file_size || mtime != desc->bookmarks_file_mtime)
+			continue;
+
+		/* numbers of rows are sorted */
+		while (*ptr != ' ')
+		{
+			long		rowno;
+			char	   *end;
+
+			rowno = strtol(ptr, &end, 10);
+			if (end == ptr || rowno < 0 || rowno >= desc->total_rows)
+				break;
+
+			while (lnb && rowno >= lnb->first_row + lnb->nrows)
+				lnb = lnb->next;
+
+			if (lnb &&
+				!(lnb->bookmarks && LINEINFO_IS_SET(lnb->bookmarks, rowno - lnb->first_row)))
+				toggle_bookmark(desc, lnb, rowno - lnb->first_row, (int) rowno);
+
+			ptr = *end == ',' ? end + 1 : end;
+		}
+	}
+
+	desc->bookmarks_changed = false;
+
+	free(line);
+	free(path);
+	fclose(fp);
+}
+
+/*
+ * Save bookmarks of file "pathname", when they were changed. Bookmarks of
+ * other files are copied from previous content of bookmarks file. The new
+ * content is written to temporary file in same directory, that replaces
+ * bookmarks file, so the file is not broken, when pspg is killed or two
+ * instances of pspg are closed together.
+ */
+void
+save_bookmarks(DataDesc *desc, const char *bookmarks_path, const char *pathname)
+{
+	FILE	   *fp;
+	char	   *path;
+	char	   *tmp_path;
+	char	  **lines = NULL;
+	int			nlines = 0;
+	char	   *line = NULL;
+	size_t		len = 0;
+	ssize_t		read;
+	bool		is_error;
+	int			fd;
+	int			i;
+
+	if (!desc->bookmarks_changed || desc->bookmarks_file_mtime == 0)
+		return;
+
+	path = full_path(pathname);
+	if (!path)
+		return;
+
+	/* read bookmarks of other files */
+	fp = fopen(bookmarks_path, "r");
+	if (fp)
+	{
+		while ((read = getline(&line, &len, fp)) != -1)
+		{
+			if (read > 0 && line[read - 1] == '\n')
+				line[read - 1] = '\0';
+
+			if (*line == '\0' || is_line_of_file(line, path))
+				continue;
+
+			lines = realloc(lines, (nlines + 1) * sizeof(char *));
+			if (!lines)
+				break;
+
+			lines[nlines++] = line;
+			line = NULL;
+		}
+
+		fclose(fp);
+	}
+
+	tmp_path = malloc(strlen(bookmarks_path) + 8);
+	if (!tmp_path)
+		goto cleanup;
+
+	sprintf(tmp_path, "%s.XXXXXX", bookmarks_path);
+
+	fd = mkstemp(tmp_path);
+	if (fd == -1)
+	{
+		free(tmp_path);
+		goto cleanup;
+	}
+
+	fp = fdopen(fd, "w");
+	if (fp)
+	{
+		/* the oldest lines are at begin */
+		i = desc->nbookmarks > 0 ? MAX_BOOKMARKED_FILES - 1 : MAX_BOOKMARKED_FILES;
+		i = nlines > i ? nlines - i : 0;
+
+		for (; i < nlines; i++)
+			fprintf(fp, "%s\n", lines[i]);
+
+		if (desc->nbookmarks > 0)
+		{
+			fprintf(fp, "%ld %ld ", desc->bookmarks_file_size, desc->bookmarks_file_mtime);
+
+			for (i = 0; i < desc->nbookmarks; i++)
+				fprintf(fp, "%s%d", i > 0 ? "," : "", desc->bookmarks[i].rowno);
+
+			fprintf(fp, " %s\n", path);
+		}
+
+		is_error = ferror(fp) != 0;
+		is_error |= fclose(fp) != 0;
+	}
+	else
+	{
+		close(fd);
+		is_error = true;
+	}
+
+	if (is_error || rename(tmp_path, bookmarks_path) != 0)
+		unlink(tmp_path);
+
+	free(tmp_path);
+
+cleanup:
+
+	for (i = 0; i < nlines; i++)
+		free(lines[i]);
+
+	free(lines);
+	free(line);
+	free(path);
+}
@@ -113,6 +113,10 @@ cmd_string(int cmd)
 			return "CSSearchSet";
 		case cmd_CISearchSet:
 			return "CISearchSet";
+		case cmd_RegexSearchToggle:
+			return "RegexSearchToggle";
+		case cmd_IncSearchToggle:
+			return "IncSearchToggle";
 		case cmd_USSearchSet:
 			return "USSearchSet";
 		case cmd_HighlightLines:
@@ -223,12 +227,18 @@ cmd_string(int cmd)
 			return "ForwardSearch";
 		case cmd_BackwardSearch:
 			return "BackwardSearch";
+		case cmd_ForwardSearchInColumn:
+			return "ForwardSearchInColumn";
+		case cmd_BackwardSearchInColumn:
+			return "BackwardSearchInColumn";
 		case cmd_SearchNext:
 			return "SearchNext";
 		case cmd_SearchPrev:
 			return "SearchPrev";
 		case cmd_SearchColumn:
 			return "SearchColumn";
+		case cmd_Filter:
+			return "Filter";
 		case cmd_ShowTopBar:
 			return "ShowTopBar";
 		case cmd_ShowBottomBar:
@@ -254,6 +264,13 @@ cmd_string(int cmd)
 			return "SortDesc";
 		case cmd_OriginalSort:
 			return "OriginalSort";
+		case cmd_AddSortAsc:
+			return "AddSortAsc";
+		case cmd_AddSortDesc:
+			return "AddSortDesc";
+
+		case cmd_ShowMemoryStats:
+			return "ShowMemoryStats";
 
 		case cmd_TogglePause:
 			return "TogglePause";
@@ -291,6 +308,14 @@ translate_event(int c, bool alt, bool watch_mode)
 				return cmd_NextBookmark;
 			case 'q':
 				return cmd_RawOutputQuit;
+			case 'r':
+				return cmd_RegexSearchToggle;
+			case 's':
+				return cmd_ShowMemoryStats;
+			case '/':
+				return cmd_ForwardSearchInColumn;
+			case '?':
+				return cmd_BackwardSearchInColumn;
 			case 'v':
 				return cmd_ShowVerticalCursor;
 			case '9':
@@ -390,12 +415,18 @@ translate_event(int c, bool alt, bool watch_mode)
 				return cmd_CursorLastRow;
 			case 'c':
 				return cmd_SearchColumn;
+			case '&':
+				return cmd_Filter;
 			case 'a':
 				return cmd_SortAsc;
 			case 'd':
 				return cmd_SortDesc;
 			case 'u':
 				return cmd_OriginalSort;
+			case 'A':
+				return cmd_AddSortAsc;
+			case 'D':
+				return cmd_AddSortDesc;
 		}
 	}
 
@@ -519,3 +550,36 @@ cmd_get_theme(int cmd)
 
 	return 1;
 }
+
+/*
+ * Returns true for commands, that only move the cursor or displayed part
+ * of data. After these commands the content of windows can be updated
+ * incrementally.
+ */
+bool
+is_cursor_move_command(int cmd)
+{
+	switch (cmd)
+	{
+		case cmd_CursorUp:
+		case cmd_CursorDown:
+		case cmd_ScrollUp:
+		case cmd_ScrollDown:
+		case cmd_ScrollUpHalfPage:
+		case cmd_ScrollDownHalfPage:
+		case cmd_PageUp:
+		case cmd_PageDown:
+		case cmd_CursorFirstRow:
+		case cmd_CursorLastRow:
+		case cmd_CursorFirstRowPage:
+		case cmd_CursorLastRowPage:
+		case cmd_CursorHalfPage:
+		case cmd_MoveLeft:
+		case cmd_MoveRight:
+		case cmd_ShowFirstCol:
+		case cmd_ShowLastCol:
+			return true;
+		default:
+			return false;
+	}
+}
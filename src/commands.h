@@ -40,6 +40,8 @@ typedef enum PspgCommand
 	cmd_CSSearchSet,
 	cmd_CISearchSet,
 	cmd_USSearchSet,
+	cmd_RegexSearchToggle,
+	cmd_IncSearchToggle,
 	cmd_HighlightLines,
 	cmd_HighlightValues,
 	cmd_NoHighlight,
@@ -95,9 +97,12 @@ typedef enum PspgCommand
 	cmd_SaveData,
 	cmd_ForwardSearch,
 	cmd_BackwardSearch,
+	cmd_ForwardSearchInColumn,
+	cmd_BackwardSearchInColumn,
 	cmd_SearchNext,
 	cmd_SearchPrev,
 	cmd_SearchColumn,
+	cmd_Filter,
 	cmd_ShowTopBar,
 	cmd_ShowBottomBar,
 	cmd_RowNumToggle,
@@ -109,12 +114,16 @@ typedef enum PspgCommand
 	cmd_SortAsc,
 	cmd_SortDesc,
 	cmd_OriginalSort,
+	cmd_AddSortAsc,
+	cmd_AddSortDesc,
+	cmd_ShowMemoryStats,
 	cmd_TogglePause
 } PspgCommand;
 
 extern void initialize_special_keycodes();
 extern const char *cmd_string(int cmd);
 extern int translate_event(int c, bool alt, bool watch_mode);
+extern bool is_cursor_move_command(int cmd);
 
 extern int cmd_get_theme(int cmd);
 extern int theme_get_cmd(int theme);
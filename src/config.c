@@ -95,6 +95,8 @@ save_config(char *path, Options *opts)
 	SAFE_SAVE_BOOL_OPTION("bold_cursor", opts->bold_cursor);
 	SAFE_SAVE_BOOL_OPTION("ignore_case", opts->ignore_case);
 	SAFE_SAVE_BOOL_OPTION("ignore_lower_case", opts->ignore_lower_case);
+	SAFE_SAVE_BOOL_OPTION("regex_search", opts->regex_search);
+	SAFE_SAVE_BOOL_OPTION("incremental_search", opts->incremental_search);
 	SAFE_SAVE_BOOL_OPTION("no_cursor", opts->no_cursor);
 	SAFE_SAVE_BOOL_OPTION("no_sound", opts->no_sound);
 	SAFE_SAVE_BOOL_OPTION("no_mouse", opts->no_mouse);
@@ -109,6 +111,7 @@ save_config(char *path, Options *opts)
 	SAFE_SAVE_BOOL_OPTION("on_sigint_exit", opts->on_sigint_exit);
 	SAFE_SAVE_BOOL_OPTION("no_sigint_search_reset", opts->no_sigint_search_reset);
 	SAFE_SAVE_BOOL_OPTION("double_header", opts->double_header);
+	SAFE_SAVE_BOOL_OPTION("save_bookmarks", opts->save_bookmarks);
 
 	result = fprintf(f, "theme = %d\n", opts->theme);
 	if (result < 0)
@@ -160,6 +163,10 @@ load_config(char *path, Options *opts)
 				opts->ignore_case = bool_val;
 			else if (strcmp(key, "ignore_lower_case") == 0)
 				opts->ignore_lower_case = bool_val;
+			else if (strcmp(key, "regex_search") == 0)
+				opts->regex_search = bool_val;
+			else if (strcmp(key, "incremental_search") == 0)
+				opts->incremental_search = bool_val;
 			else if (strcmp(key, "no_sound") == 0)
 				opts->no_sound = bool_val;
 			else if (strcmp(key, "no_cursor") == 0)
@@ -192,6 +199,8 @@ load_config(char *path, Options *opts)
 				opts->on_sigint_exit = bool_val;
 			else if (strcmp(key, "no_sigint_search_reset") == 0)
 				opts->no_sigint_search_reset = bool_val;
+			else if (strcmp(key, "save_bookmarks") == 0)
+				opts->save_bookmarks = bool_val;
 
 			free(line);
 			line = NULL;
@@ -21,6 +21,8 @@ typedef struct
 	char   *pathname;
 	bool	ignore_case;
 	bool	ignore_lower_case;
+	bool	regex_search;
+	bool	incremental_search;
 	bool	no_sound;
 	bool	no_mouse;
 	bool	less_status_bar;
@@ -53,6 +55,10 @@ typedef struct
 	bool	force_password_prompt;
 	char   *password;
 	char   *dbname;
+	char   *bench_render;			/* script of commands for --bench-render */
+	bool	show_memstats;			/* show memory usage overlay */
+	bool	print_stats;			/* print memory usage on exit */
+	bool	save_bookmarks;			/* bookmarks are saved per file */
 } Options;
 
 extern bool save_config(char *path, Options *opts);
@@ -0,0 +1,422 @@
+/*-------------------------------------------------------------------------
+ *
+ * filter.c
+ *	  filtering of displayed rows
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/filter.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+typedef enum
+{
+	FILTER_TEXT,					/* row contains pattern */
+	FILTER_EQ,
+	FILTER_NE,
+	FILTER_LT,
+	FILTER_LE,
+	FILTER_GT,
+	FILTER_GE,
+	FILTER_MATCH,					/* column contains pattern */
+	FILTER_NOT_MATCH
+} FilterOperator;
+
+/*
+ * Filter is a pattern, that should be in displayed rows, or a predicate
+ * "column operator value". The column can be specified by name or by
+ * number like "col5".
+ */
+typedef struct
+{
+	int				column;			/* column number or zero for FILTER_TEXT */
+	FilterOperator	op;
+	char			value[256];		/* pattern or value for comparing */
+	bool			is_numeric;		/* true, when value is a number */
+	double			d;				/* numeric value */
+	SearchMode		mode;			/* mode used for pattern searching */
+	bool			regex;			/* true, when pattern is regular expression */
+} FilterExpr;
+
+static const struct
+{
+	const char	   *str;
+	FilterOperator	op;
+} filter_operators[] = {
+	{"<=", FILTER_LE},
+	{">=", FILTER_GE},
+	{"!=", FILTER_NE},
+	{"<>", FILTER_NE},
+	{"!~", FILTER_NOT_MATCH},
+	{"==", FILTER_EQ},
+	{"=", FILTER_EQ},
+	{"<", FILTER_LT},
+	{">", FILTER_GT},
+	{"~", FILTER_MATCH},
+	{NULL}
+};
+
+/*
+ * Returns column number of column specified by name or by "colN"
+ * notation, or zero, when there is not this column.
+ */
+static int
+find_column(Options *opts, DataDesc *desc, const char *name, int name_size)
+{
+	int		i;
+
+	if (!desc->cranges || desc->columns == 0)
+		return 0;
+
+	if (name_size > 3 && strncasecmp(name, "col", 3) == 0)
+	{
+		int		colno = 0;
+
+		for (i = 3; i < name_size && isdigit((unsigned char) name[i]); i++)
+			colno = colno * 10 + name[i] - '0';
+
+		if (i == name_size && colno >= 1 && colno <= desc->columns)
+			return colno;
+	}
+
+	/*
+	 * The names are taken from the row above headline. desc->namesline
+	 * cannot be used, because it is not available when the row of names
+	 * is shorter than headline.
+	 */
+	if (desc->border_head_row > 0 && desc->border_head_row <= desc->rows.nrows)
+	{
+		char   *namesline = desc->rows.rows[desc->border_head_row - 1];
+
+		for (i = 0; i < desc->columns; i++)
+		{
+			char   *str;
+			int		size = 0;
+
+			str = get_column_text(opts, desc, namesline, i + 1, false, &size);
+
+			if (str && size == name_size && strncasecmp(str, name, name_size) == 0)
+				return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Parse filter expression. When the expression is not valid predicate
+ * on some column, then it is used as pattern searched in whole row.
+ */
+static bool
+parse_filter(Options *opts, DataDesc *desc, const char *expr, FilterExpr *fe,
+			 char *errbuf, int errbuf_size)
+{
+	const char *ptr = expr;
+	const char *name;
+	const char *value = expr;
+	int			name_size;
+	int			column = 0;
+	int			i;
+
+	memset(fe, 0, sizeof(FilterExpr));
+
+	fe->op = FILTER_TEXT;
+
+	while (isspace((unsigned char) *ptr))
+		ptr += 1;
+
+	name = ptr;
+	while (*ptr && !isspace((unsigned char) *ptr) && !strchr("=<>!~", *ptr))
+		ptr += 1;
+
+	name_size = ptr - name;
+
+	while (isspace((unsigned char) *ptr))
+		ptr += 1;
+
+	for (i = 0; filter_operators[i].str; i++)
+	{
+		int		len = strlen(filter_operators[i].str);
+
+		if (strncmp(ptr, filter_operators[i].str, len) == 0)
+		{
+			if (name_size > 0)
+				column = find_column(opts, desc, name, name_size);
+
+			if (column > 0)
+			{
+				fe->column = column;
+				fe->op = filter_operators[i].op;
+				value = ptr + len;
+			}
+
+			break;
+		}
+	}
+
+	if (fe->op != FILTER_TEXT)
+	{
+		const char *end;
+
+		while (isspace((unsigned char) *value))
+			value += 1;
+
+		end = value + strlen(value);
+		while (end > value && isspace((unsigned char) end[-1]))
+			end -= 1;
+
+		/* value can be quoted */
+		if (end - value >= 2 && (*value == '\'' || *value == '"') && end[-1] == *value)
+		{
+			value += 1;
+			end -= 1;
+		}
+
+		if (end - value >= (int) sizeof(fe->value))
+			end = value + sizeof(fe->value) - 1;
+
+		memcpy(fe->value, value, end - value);
+		fe->value[end - value] = '\0';
+	}
+	else
+	{
+		strncpy(fe->value, value, sizeof(fe->value) - 1);
+		fe->value[sizeof(fe->value) - 1] = '\0';
+	}
+
+	if (fe->value[0] == '\0' && fe->op == FILTER_TEXT)
+	{
+		snprintf(errbuf, errbuf_size, "empty filter");
+		return false;
+	}
+
+	if (fe->op != FILTER_TEXT && fe->op != FILTER_MATCH && fe->op != FILTER_NOT_MATCH)
+	{
+		char   *endptr;
+
+		errno = 0;
+		fe->d = strtod(fe->value, &endptr);
+		fe->is_numeric = errno == 0 && *fe->value != '\0' && *endptr == '\0';
+	}
+	else
+	{
+		if (opts->ignore_case || (opts->ignore_lower_case && !has_upperchr(opts, fe->value)))
+			fe->mode = SEARCH_IGNORE_CASE;
+		else if (opts->ignore_lower_case)
+			fe->mode = SEARCH_IGNORE_LOWER_CASE;
+		else
+			fe->mode = SEARCH_CASE_SENSITIVE;
+
+		fe->regex = opts->regex_search;
+
+		if (fe->regex &&
+			!check_regex(fe->value, fe->mode == SEARCH_IGNORE_CASE, errbuf, errbuf_size))
+			return false;
+	}
+
+	return true;
+}
+
+static bool
+contains_pattern(FilterExpr *fe, const char *str, bool force8bit)
+{
+	if (fe->regex)
+	{
+		int		size;
+
+		return search_regex(str, str, fe->value, fe->mode == SEARCH_IGNORE_CASE, &size) != NULL;
+	}
+
+	return search_pattern(str, fe->value, fe->mode, force8bit) != NULL;
+}
+
+/*
+ * Returns true, when some row of record (first row and continuation
+ * rows of multiline values) contains pattern.
+ */
+static bool
+record_contains_pattern(Options *opts, DataDesc *desc, MappedLine *dr, FilterExpr *fe)
+{
+	LineBuffer *lnb = dr->lnb;
+	int			lnb_row = dr->lnb_row;
+
+	for (;;)
+	{
+		if (contains_pattern(fe, lnb->rows[lnb_row], opts->force8bit))
+			return true;
+
+		if (!desc->has_multilines || !lnb->continuations ||
+			!LINEINFO_IS_SET(lnb->continuations, lnb_row))
+			break;
+
+		lnb_row += 1;
+		if (lnb_row >= lnb->nrows)
+		{
+			lnb = lnb->next;
+			lnb_row = 0;
+
+			if (!lnb)
+				break;
+		}
+	}
+
+	return false;
+}
+
+static bool
+compare_result(FilterOperator op, int cmp)
+{
+	switch (op)
+	{
+		case FILTER_EQ:
+			return cmp == 0;
+		case FILTER_NE:
+			return cmp != 0;
+		case FILTER_LT:
+			return cmp < 0;
+		case FILTER_LE:
+			return cmp <= 0;
+		case FILTER_GT:
+			return cmp > 0;
+		case FILTER_GE:
+			return cmp >= 0;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Evaluate predicate on column of one record. Only first row of multiline
+ * record is used.
+ */
+static bool
+eval_column_predicate(Options *opts, DataDesc *desc, ColumnData *cd, int recno, FilterExpr *fe)
+{
+	MappedLine *dr = &desc->records[recno];
+	char		buffer[1024];
+	char	   *text;
+	int			size = 0;
+
+	/* fast path, numeric values are prepared already */
+	if (fe->is_numeric && cd && !cd->is_string)
+	{
+		double	d;
+
+		if (COLUMN_DATA_IS_NULL(cd, recno))
+			return false;
+
+		d = cd->values[recno];
+
+		return compare_result(fe->op, d < fe->d ? -1 : (d > fe->d ? 1 : 0));
+	}
+
+	text = get_column_text(opts, desc, dr->lnb->rows[dr->lnb_row], fe->column,
+						   RECORD_IS_CONTINUED(desc, dr), &size);
+
+	if (size >= (int) sizeof(buffer))
+		size = sizeof(buffer) - 1;
+
+	if (text)
+		memcpy(buffer, text, size);
+	buffer[size] = '\0';
+
+	if (fe->op == FILTER_MATCH)
+		return contains_pattern(fe, buffer, opts->force8bit);
+	else if (fe->op == FILTER_NOT_MATCH)
+		return !contains_pattern(fe, buffer, opts->force8bit);
+
+	return compare_result(fe->op,
+						  opts->force8bit ? strcmp(buffer, fe->value) : strcoll(buffer, fe->value));
+}
+
+/*
+ * Releases filter. Rows are displayed again after order map update.
+ */
+void
+free_filter(DataDesc *desc)
+{
+	if (desc->hidden_records)
+	{
+		mem_free(MEM_FILTER, (desc->nrecords >> 3) + 1);
+		free(desc->hidden_records);
+	}
+
+	desc->hidden_records = NULL;
+	desc->nvisible_records = 0;
+}
+
+/*
+ * Mark records that doesn't satisfy the filter expression as hidden.
+ * The records are evaluated in one pass over cached column values
+ * (when it is possible). Order map should be updated after.
+ */
+bool
+apply_filter(Options *opts, DataDesc *desc, const char *expr, char *errbuf, int errbuf_size)
+{
+	FilterExpr	fe;
+	ColumnData *cd = NULL;
+	int			bitmap_size;
+	int			i;
+
+	if (desc->is_expanded_mode)
+	{
+		snprintf(errbuf, errbuf_size, "filter is not supported in expanded mode");
+		return false;
+	}
+
+	if (desc->first_data_row < 0 || desc->last_data_row < desc->first_data_row)
+	{
+		snprintf(errbuf, errbuf_size, "there are not data rows");
+		return false;
+	}
+
+	if (!parse_filter(opts, desc, expr, &fe, errbuf, errbuf_size))
+		return false;
+
+	prepare_records(opts, desc);
+
+	if (fe.column > 0 && fe.is_numeric)
+		cd = get_column_data(opts, desc, fe.column);
+
+	free_filter(desc);
+
+	bitmap_size = (desc->nrecords >> 3) + 1;
+
+	desc->hidden_records = malloc(bitmap_size);
+	if (!desc->hidden_records)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_FILTER, bitmap_size);
+
+	memset(desc->hidden_records, 0, bitmap_size);
+
+	for (i = 0; i < desc->nrecords; i++)
+	{
+		bool	visible;
+
+		if (fe.op == FILTER_TEXT)
+			visible = record_contains_pattern(opts, desc, &desc->records[i], &fe);
+		else
+			visible = eval_column_predicate(opts, desc, cd, i, &fe);
+
+		if (visible)
+			desc->nvisible_records += 1;
+		else
+			RECORD_SET_HIDDEN(desc, i);
+	}
+
+	return true;
+}
@@ -0,0 +1,174 @@
+/*-------------------------------------------------------------------------
+ *
+ * memstats.c
+ *	  accounting of memory used by data and auxiliary structures
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/memstats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#if defined HAVE_NCURSESW_CURSES_H
+#include <ncursesw/curses.h>
+#elif defined HAVE_NCURSESW_H
+#include <ncursesw.h>
+#elif defined HAVE_NCURSES_CURSES_H
+#include <ncurses/curses.h>
+#elif defined HAVE_NCURSES_H
+#include <ncurses.h>
+#elif defined HAVE_CURSES_H
+#include <curses.h>
+#else
+/* fallback */
+#include <ncurses/ncurses.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/resource.h>
+
+#include "pspg.h"
+
+/*
+ * Sizes are requested sizes of allocations, the overhead of allocator
+ * is not counted.
+ */
+typedef struct
+{
+	long		current;			/* allocated bytes now */
+	long		peak;				/* max of allocated bytes */
+	long		allocs;				/* number of allocations */
+} MemCounter;
+
+static const char *mem_category_names[] = {
+	"row text",
+	"LineBuffer nodes",
+	"line info bitmaps",
+	"column offsets",
+	"records, order map",
+	"column data",
+	"sort buffers",
+	"search cache",
+	"filter",
+	"csv/query buckets"
+};
+
+static MemCounter mem_counters[MEM_CATEGORIES];
+static long mem_total = 0;
+static long mem_total_peak = 0;
+
+void
+mem_alloc(MemCategory cat, long size)
+{
+	MemCounter *mc = &mem_counters[cat];
+
+	mc->current += size;
+	mc->allocs += 1;
+
+	if (mc->current > mc->peak)
+		mc->peak = mc->current;
+
+	mem_total += size;
+	if (mem_total > mem_total_peak)
+		mem_total_peak = mem_total;
+}
+
+void
+mem_free(MemCategory cat, long size)
+{
+	mem_counters[cat].current -= size;
+	mem_total -= size;
+}
+
+/*
+ * Returns size in human readable form
+ */
+static char *
+format_size(char *buffer, int size, long bytes)
+{
+	if (bytes < 10 * 1024L)
+		snprintf(buffer, size, "%ld B", bytes);
+	else if (bytes < 10 * 1024L * 1024L)
+		snprintf(buffer, size, "%ld kB", bytes / 1024);
+	else
+		snprintf(buffer, size, "%ld MB", bytes / (1024 * 1024));
+
+	return buffer;
+}
+
+/*
+ * Prints table of memory usage (used by --stats)
+ */
+void
+memstats_report(FILE *fp)
+{
+	struct rusage usage;
+	int			i;
+
+	fprintf(fp, "%-20s %14s %14s %12s\n", "memory", "current", "peak", "allocations");
+
+	for (i = 0; i < MEM_CATEGORIES; i++)
+	{
+		MemCounter *mc = &mem_counters[i];
+
+		fprintf(fp, "%-20s %14ld %14ld %12ld\n",
+				mem_category_names[i], mc->current, mc->peak, mc->allocs);
+	}
+
+	fprintf(fp, "%-20s %14ld %14ld\n", "total", mem_total, mem_total_peak);
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		fprintf(fp, "\nmax resident set size: %ld kB\n", usage.ru_maxrss);
+}
+
+/*
+ * Returns number of lines and width of memory usage overlay
+ */
+void
+memstats_overlay_size(int *rows, int *cols)
+{
+	*rows = MEM_CATEGORIES + 4;
+	*cols = 45;
+}
+
+/*
+ * Draws current and peak values into window with box
+ */
+void
+memstats_draw(WINDOW *win, attr_t data_attr, attr_t line_attr)
+{
+	char		buffer1[32];
+	char		buffer2[32];
+	int			i;
+
+	wbkgd(win, data_attr);
+	werase(win);
+
+	wattron(win, line_attr);
+	box(win, 0, 0);
+	wattroff(win, line_attr);
+
+	mvwprintw(win, 0, 2, " Memory usage ");
+	mvwprintw(win, 1, 2, "%-20s %9s %9s", "", "current", "peak");
+
+	for (i = 0; i < MEM_CATEGORIES; i++)
+	{
+		MemCounter *mc = &mem_counters[i];
+
+		mvwprintw(win, i + 2, 2, "%-20s %9s %9s",
+				  mem_category_names[i],
+				  format_size(buffer1, sizeof(buffer1), mc->current),
+				  format_size(buffer2, sizeof(buffer2), mc->peak));
+	}
+
+	mvwprintw(win, MEM_CATEGORIES + 2, 2, "%-20s %9s %9s",
+			  "total",
+			  format_size(buffer1, sizeof(buffer1), mem_total),
+			  format_size(buffer2, sizeof(buffer2), mem_total_peak));
+
+	wnoutrefresh(win);
+}
@@ -46,7 +46,10 @@ ST_MENU_ITEM _search[] = {
 	{"Search ~a~gain", cmd_SearchNext, "n"},
 	{"Search p~r~evious", cmd_SearchPrev, "N"},
 	{"--"},
+	{"Search ~i~n column", cmd_ForwardSearchInColumn, "M-/"},
+	{"Search in column bac~k~ward", cmd_BackwardSearchInColumn, "M-?"},
 	{"Search ~c~olumn", cmd_SearchColumn, "c"},
+	{"Fi~l~ter rows", cmd_Filter, "&"},
 	{"--"},
 	{"~T~oggle bookmark", cmd_ToggleBookmark, "M-k"},
 	{"~P~rev bookmark", cmd_PrevBookmark, "M-i"},
@@ -79,6 +82,8 @@ ST_MENU_ITEM _command[] = {
 	{"--"},
 	{"As~c~ending order", cmd_SortAsc, "a"},
 	{"~D~escending order", cmd_SortDesc, "d"},
+	{"Add ascendin~g~ key", cmd_AddSortAsc, "A"},
+	{"Add descend~i~ng key", cmd_AddSortDesc, "D"},
 	{"~O~riginal order", cmd_OriginalSort, "u"},
 	{NULL}
 };
@@ -112,6 +117,8 @@ ST_MENU_ITEM _options[] = {
 	{"~C~ase sensitive search", cmd_CSSearchSet, NULL},
 	{"Case ~i~nsensitive search", cmd_CISearchSet, NULL},
 	{"~U~pper case sensitive search", cmd_USSearchSet, NULL},
+	{"~R~egular expression search", cmd_RegexSearchToggle, "M-r"},
+	{"Incremental searc~h~", cmd_IncSearchToggle, NULL},
 	{"--"},
 	{"Highlight searched ~l~ines", cmd_HighlightLines, NULL},
 	{"Highlight searched ~v~alues", cmd_HighlightValues, NULL},
@@ -122,6 +129,7 @@ ST_MENU_ITEM _options[] = {
 	{"Show line ~n~umbers", cmd_RowNumToggle, "M-n"},
 	{"Show top bar", cmd_ShowTopBar, NULL},
 	{"Show bottom bar", cmd_ShowBottomBar, NULL},
+	{"Show memory usage", cmd_ShowMemoryStats, "M-s"},
 	{"--"},
 	{"~M~ouse support", cmd_MouseToggle, "M-m"},
 	{"~Q~uiet mode", cmd_SoundToggle, NULL},
@@ -303,9 +311,12 @@ post_menu(Options *opts, struct ST_MENU *menu)
 									  !(opts->ignore_case || opts->ignore_lower_case));
 	st_menu_set_option(menu, cmd_CISearchSet, ST_MENU_OPTION_MARKED, opts->ignore_case);
 	st_menu_set_option(menu, cmd_USSearchSet, ST_MENU_OPTION_MARKED, opts->ignore_lower_case);
+	st_menu_set_option(menu, cmd_RegexSearchToggle, ST_MENU_OPTION_MARKED, opts->regex_search);
+	st_menu_set_option(menu, cmd_IncSearchToggle, ST_MENU_OPTION_MARKED, opts->incremental_search);
 
 	st_menu_set_option(menu, cmd_ShowTopBar, ST_MENU_OPTION_MARKED, !opts->no_topbar);
 	st_menu_set_option(menu, cmd_ShowBottomBar, ST_MENU_OPTION_MARKED, !opts->no_commandbar);
+	st_menu_set_option(menu, cmd_ShowMemoryStats, ST_MENU_OPTION_MARKED, opts->show_memstats);
 
 	st_menu_set_option(menu, cmd_RowNumToggle, ST_MENU_OPTION_MARKED, opts->show_rownum);
 	st_menu_set_option(menu, cmd_ShowCursor, ST_MENU_OPTION_MARKED, !opts->no_cursor);
@@ -39,6 +39,8 @@ push_row(RowBucketType *rb, RowType *row, bool is_multiline)
 		new->allocated = true;
 		new->next_bucket = NULL;
 
+		mem_alloc(MEM_CSV, sizeof(RowBucketType));
+
 		rb->next_bucket = new;
 		rb = new;
 	}
@@ -233,6 +235,9 @@ pg_exec_query(Options *opts, RowBucketType *rb, PrintDataDesc *pdesc, const char
 	if (!row)
 		EXIT_OUT_OF_MEMORY();
 
+	mem_alloc(MEM_CSV, size);
+	mem_alloc(MEM_CSV, offsetof(RowType, fields) + (nfields * sizeof(char *)));
+
 	row->nfields = nfields;
 
 	multiline_row = false;
@@ -270,6 +275,9 @@ pg_exec_query(Options *opts, RowBucketType *rb, PrintDataDesc *pdesc, const char
 		if (!row)
 			EXIT_OUT_OF_MEMORY();
 
+		mem_alloc(MEM_CSV, size);
+		mem_alloc(MEM_CSV, offsetof(RowType, fields) + (nfields * sizeof(char *)));
+
 		row->nfields = nfields;
 
 		multiline_row = false;
@@ -93,6 +93,9 @@ pb_flush_line(PrintbufType *printbuf)
 		LineBuffer *nb = smalloc(sizeof(LineBuffer), "serialize csv output");
 
 		memset(nb, 0, sizeof(LineBuffer));
+		mem_alloc(MEM_LINEBUFFERS, sizeof(LineBuffer));
+
+		nb->first_row = printbuf->linebuf->first_row + printbuf->linebuf->nrows;
 
 		printbuf->linebuf->next = nb;
 		nb->prev = printbuf->linebuf;
@@ -103,6 +106,8 @@ pb_flush_line(PrintbufType *printbuf)
 	memcpy(line, printbuf->buffer, printbuf->used);
 	line[printbuf->used] = '\0';
 
+	mem_alloc(MEM_ROWS, printbuf->used + 1);
+
 	printbuf->linebuf->rows[printbuf->linebuf->nrows++] = line;
 
 	if (printbuf->used > printbuf->maxbytes)
@@ -479,6 +484,7 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 
 				row = smalloc(size, "RowType");
 				memcpy(row, source, size);
+				mem_alloc(MEM_CSV, size);
 
 				free_row = true;
 			}
@@ -556,7 +562,7 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 								more_lines |= _more_lines;
 							}
 							else
-								width = utf_string_dsplen(field, SIZE_MAX);
+								width = utf_string_dsplen(field, strlen(field));
 						}
 
 						spaces = pdesc->widths[j] - width;
@@ -639,7 +645,10 @@ pb_print_rowbuckets(PrintbufType *printbuf,
 			}
 
 			if (free_row)
+			{
+				mem_free(MEM_CSV, offsetof(RowType, fields) + (row->nfields * sizeof(char*)));
 				free(row);
+			}
 		}
 
 		rb = rb->next_bucket;
@@ -701,6 +710,9 @@ read_csv(RowBucketType *rb,
 	int		instr = false;			/* true when csv string is processed */
 	int		c;
 
+	rb->nrows = 0;
+	rb->next_bucket = NULL;
+
 	c = fgetc(ifile);
 	do
 	{
@@ -844,6 +856,8 @@ read_csv(RowBucketType *rb,
 				new->allocated = true;
 				new->next_bucket = NULL;
 
+				mem_alloc(MEM_CSV, sizeof(RowBucketType));
+
 				rb->next_bucket = new;
 				rb = new;
 			}
@@ -861,6 +875,9 @@ read_csv(RowBucketType *rb,
 			row = smalloc(offsetof(RowType, fields) + (nfields * sizeof(char*)), "import csv data");
 			row->nfields = nfields;
 
+			mem_alloc(MEM_CSV, data_size);
+			mem_alloc(MEM_CSV, offsetof(RowType, fields) + (nfields * sizeof(char*)));
+
 			multiline = false;
 
 			for (i = 0; i < nfields; i++)
@@ -1003,8 +1020,29 @@ read_and_format(FILE *fp, Options *opts, DataDesc *desc, const char **err)
 	desc->is_pgcli_fmt = false;
 	desc->namesline = NULL;
 	desc->order_map = NULL;
+	desc->sort_cache = NULL;
+	desc->search_index = NULL;
+	desc->hidden_records = NULL;
+	desc->nvisible_records = 0;
+	desc->hidden_rows = 0;
+	desc->bookmarks = NULL;
+	desc->nbookmarks = 0;
+	desc->bookmarks_size = 0;
+	desc->bookmark_positions = NULL;
+	desc->nbookmark_positions = 0;
+	desc->bookmark_positions_valid = false;
+	desc->bookmarks_changed = false;
+	desc->bookmarks_file_size = 0;
+	desc->bookmarks_file_mtime = 0;
+	desc->column_data = NULL;
+	desc->records = NULL;
+	desc->nrecords = 0;
+	desc->nsort_keys = 0;
+	desc->order_map_is_partial = false;
+	desc->order_map_sorted_records = 0;
 	desc->total_rows = 0;
 	desc->multilines_already_tested = false;
+	desc->has_multilines = false;
 
 	desc->maxbytes = -1;
 	desc->maxx = -1;
@@ -1075,7 +1113,7 @@ read_and_format(FILE *fp, Options *opts, DataDesc *desc, const char **err)
 			if (opts->force8bit)
 				desc->headline_char_size = desc->headline_size;
 			else
-				desc->headline_char_size = desc->maxx = utf_string_dsplen(desc->headline, SIZE_MAX);
+				desc->headline_char_size = desc->maxx = utf_string_dsplen(desc->headline, desc->headline_size);
 
 			desc->first_data_row = desc->border_head_row + 1;
 
@@ -1217,13 +1255,23 @@ read_and_format(FILE *fp, Options *opts, DataDesc *desc, const char **err)
 
 			/* only first field holds allocated string */
 			if (r->nfields > 0)
+			{
+				char   *last = r->fields[r->nfields - 1];
+
+				mem_free(MEM_CSV, last - r->fields[0] + strlen(last) + 1);
 				free(r->fields[0]);
+			}
+
+			mem_free(MEM_CSV, offsetof(RowType, fields) + (r->nfields * sizeof(char*)));
 			free(r);
 		}
 
 		nextrb = rb->next_bucket;
 		if (rb->allocated)
+		{
+			mem_free(MEM_CSV, sizeof(RowBucketType));
 			free(rb);
+		}
 		rb = nextrb;
 	}
 
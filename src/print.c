@@ -26,7 +26,10 @@
 #include <ncurses/ncurses.h>
 #endif
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -130,6 +133,322 @@ flush_bytes(WINDOW *win,
 	}
 }
 
+/*
+ * Returns true, when names line has only spaces between display
+ * positions xmin and xmax.
+ */
+static bool
+is_blank_names_area(char *namesline, Options *opts, int xmin, int xmax)
+{
+	char   *str = namesline;
+	int		pos = 0;
+
+	while (*str && pos <= xmax)
+	{
+		if (pos >= xmin && *str != ' ')
+			return false;
+
+		pos += opts->force8bit ? 1 : utf_dsplen(str);
+		str += opts->force8bit ? 1 : utf8charlen(*str);
+	}
+
+	return true;
+}
+
+/*
+ * Draws text of size "width" on display position "x" when it is visible
+ */
+static void
+draw_visible_mark(WINDOW *win, int y, int x, int srcx, int maxx, const char *str, int width)
+{
+	if (x - srcx >= 0 && x + width - 1 - srcx < maxx)
+		mvwaddstr(win, y, x - srcx, str);
+}
+
+/*
+ * Draw sort direction marks after names of sorted columns. The mark is
+ * drawn to padding after name, or (when the name is aligned to end of
+ * column) to free space before name. When data are sorted by more columns,
+ * the order of sort key is displayed at begin of column (when there is a
+ * free space). The column's name is never overwritten.
+ */
+static void
+draw_sort_marks(WINDOW *win,
+				int srcy,
+				int srcx,
+				DataDesc *desc,
+				Theme *t,
+				Options *opts)
+{
+	bool	use_ascii = opts->force8bit || desc->linestyle != 'u';
+	char   *namesline;
+	int		maxy, maxx;
+	int		y;
+	int		i;
+
+	if (!desc->order_map || desc->nsort_keys == 0 || desc->is_expanded_mode ||
+		desc->border_head_row < 1 || !desc->headline_transl)
+		return;
+
+	getmaxyx(win, maxy, maxx);
+
+	/* names of columns are in row before head border */
+	y = desc->border_head_row - 1 - srcy;
+	if (y < 0 || y >= maxy)
+		return;
+
+	namesline = desc->rows.rows[desc->border_head_row - 1];
+
+	wattron(win, t->expi_attr);
+
+	for (i = 0; i < desc->nsort_keys; i++)
+	{
+		CRange	   *cr = &desc->cranges[desc->sort_keys[i].column - 1];
+		int			start, end;
+		int			mark_x;
+
+		/* don't overwrite column's borders */
+		start = desc->headline_transl[cr->xmin] == 'd' ? cr->xmin : cr->xmin + 1;
+		end = desc->headline_transl[cr->xmax] == 'd' ? cr->xmax : cr->xmax - 1;
+
+		if (end < start)
+			continue;
+
+		if (is_blank_names_area(namesline, opts, end, end))
+			mark_x = end;
+		else
+		{
+			/* find last free position before name */
+			mark_x = start - 1;
+			while (mark_x < end && is_blank_names_area(namesline, opts, start, mark_x + 1))
+				mark_x += 1;
+		}
+
+		/* there is not free space for mark */
+		if (mark_x < start)
+			continue;
+
+		if (desc->sort_keys[i].desc)
+			draw_visible_mark(win, y, mark_x, srcx, maxx, use_ascii ? "v" : "\342\206\223", 1);
+		else
+			draw_visible_mark(win, y, mark_x, srcx, maxx, use_ascii ? "^" : "\342\206\221", 1);
+
+		if (desc->nsort_keys > 1 && start < mark_x &&
+			is_blank_names_area(namesline, opts, start, start))
+		{
+			char	buffer[2];
+
+			buffer[0] = '1' + i;
+			buffer[1] = '\0';
+
+			draw_visible_mark(win, y, start, srcx, maxx, buffer, 1);
+		}
+	}
+
+	wattroff(win, t->expi_attr);
+}
+
+/*
+ * Returns display positions and byte offsets of begins of columns in row.
+ * The offsets are calculated when the row is displayed with horizontal
+ * offset or when some column of row is searched first time. Every offset
+ * is the last char boundary before column's xmin, so the row can be cut
+ * there without any change of result.
+ */
+ColumnOffset *
+get_column_offsets(Options *opts, DataDesc *desc, LineBuffer *lnb, int lnb_row)
+{
+	ColumnOffset *offsets;
+	char	   *rowstr;
+	char	   *str;
+	int			pos = 0;
+	int			i;
+
+	if (!lnb->coloffsets)
+	{
+		lnb->coloffsets = malloc(1000 * sizeof(ColumnOffset *));
+		if (!lnb->coloffsets)
+			leave_ncurses("out of memory");
+
+		memset(lnb->coloffsets, 0, 1000 * sizeof(ColumnOffset *));
+		mem_alloc(MEM_COLOFFSETS, 1000 * sizeof(ColumnOffset *));
+	}
+
+	if (lnb->coloffsets[lnb_row])
+		return lnb->coloffsets[lnb_row];
+
+	offsets = malloc(desc->columns * sizeof(ColumnOffset));
+	if (!offsets)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_COLOFFSETS, desc->columns * sizeof(ColumnOffset));
+
+	rowstr = str = lnb->rows[lnb_row];
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		int		xmin = desc->cranges[i].xmin;
+
+		while (*str != '\0' && *str != '\n' && pos < xmin)
+		{
+			int		dsplen = opts->force8bit ? 1 : utf_dsplen(str);
+
+			if (pos + dsplen > xmin)
+				break;
+
+			pos += dsplen;
+			str += opts->force8bit ? 1 : utf8charlen(*str);
+		}
+
+		offsets[i].offset = str - rowstr;
+		offsets[i].pos = pos;
+	}
+
+	lnb->coloffsets[lnb_row] = offsets;
+
+	return offsets;
+}
+
+/*
+ * Returns search state of rows of LineBuffer. It is allocated, when it
+ * is required first time.
+ */
+static SearchInfo *
+get_searchinfo(LineBuffer *lnb)
+{
+	if (!lnb->searchinfo)
+	{
+		lnb->searchinfo = malloc(sizeof(SearchInfo));
+		if (!lnb->searchinfo)
+			leave_ncurses("out of memory");
+
+		memset(lnb->searchinfo, 0, sizeof(SearchInfo));
+		mem_alloc(MEM_LINEINFO, sizeof(SearchInfo));
+	}
+
+	return lnb->searchinfo;
+}
+
+/*
+ * Returns position of row in sorted array of start positions, or
+ * position where it should be inserted.
+ */
+static int
+start_char_position(SearchInfo *si, int row)
+{
+	int			lo = 0;
+	int			hi = si->nstarts;
+
+	while (lo < hi)
+	{
+		int		mid = (lo + hi) / 2;
+
+		if (si->starts[mid].row < row)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int
+get_start_char(SearchInfo *si, int row)
+{
+	int			pos = start_char_position(si, row);
+
+	if (pos < si->nstarts && si->starts[pos].row == row)
+		return si->starts[pos].start_char;
+
+	return 0;
+}
+
+static void
+set_start_char(SearchInfo *si, int row, int start_char)
+{
+	int			pos = start_char_position(si, row);
+
+	if (pos >= si->nstarts || si->starts[pos].row != row)
+	{
+		if (si->nstarts == si->starts_size)
+		{
+			int		size = si->starts_size > 0 ? si->starts_size * 2 : 16;
+
+			si->starts = realloc(si->starts, size * sizeof(StartChar));
+			if (!si->starts)
+				leave_ncurses("out of memory");
+
+			mem_alloc(MEM_LINEINFO, (size - si->starts_size) * sizeof(StartChar));
+			si->starts_size = size;
+		}
+
+		memmove(&si->starts[pos + 1], &si->starts[pos],
+				(si->nstarts - pos) * sizeof(StartChar));
+
+		si->starts[pos].row = row;
+		si->nstarts += 1;
+	}
+
+	si->starts[pos].start_char = start_char;
+}
+
+/*
+ * Skip first srcx display chars of row. When the row is a part of table,
+ * then the skipping starts from nearest column on left side. left_spaces
+ * is number of positions, that should be filled by spaces, when some wide
+ * char is cut.
+ */
+static char *
+skip_display_chars(Options *opts, DataDesc *desc, char *rowstr,
+				   LineBuffer *lnb, int lnb_row,
+				   int srcx, int *left_spaces)
+{
+	int			i = srcx;
+
+	*left_spaces = 0;
+
+	if (srcx > 0 && lnb && desc->cranges && desc->columns > 0 &&
+		!desc->is_expanded_mode && desc->cranges[0].xmin <= srcx)
+	{
+		ColumnOffset *offsets = get_column_offsets(opts, desc, lnb, lnb_row);
+		int			lo = 0;
+		int			hi = desc->columns - 1;
+
+		/* find last column starting before srcx */
+		while (lo < hi)
+		{
+			int		mid = (lo + hi + 1) / 2;
+
+			if (desc->cranges[mid].xmin <= srcx)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+
+		rowstr += offsets[lo].offset;
+		i -= offsets[lo].pos;
+	}
+
+	while (i > 0 && *rowstr != '\0' && *rowstr != '\n')
+	{
+		if (opts->force8bit)
+		{
+			i -= 1;
+			rowstr += 1;
+		}
+		else
+		{
+			i -= utf_dsplen(rowstr);
+			rowstr += utf8charlen(*rowstr);
+		}
+
+		if (i < 0)
+			*left_spaces = -i;
+	}
+
+	return rowstr;
+}
+
 void
 window_fill(int window_identifier,
 			int srcy,
@@ -155,6 +474,11 @@ window_fill(int window_identifier,
 	bool		is_fix_rows = window_identifier == WINDOW_LUC || window_identifier == WINDOW_FIX_ROWS;
 	bool		is_rownum = window_identifier == WINDOW_ROWNUM;
 	bool		is_rownum_luc = window_identifier == WINDOW_ROWNUM_LUC;
+	FillState  *fs;
+	bool		is_partial = false;
+	int			new_rows_from = 0;
+	int			new_rows_to = 0;
+	int			old_cursor_row = -1;
 
 	win = scrdesc->wins[window_identifier];
 	t = &scrdesc->themes[window_identifier];
@@ -191,13 +515,64 @@ window_fill(int window_identifier,
 
 	getmaxyx(win, maxy, maxx);
 
+	fs = &scrdesc->fill_state[window_identifier];
+
+	/*
+	 * When only displayed rows or cursor were changed, then the content of
+	 * window is scrolled, and only new rows and rows with old and new cursor
+	 * are drawn. Expanded mode requires full drawing, because the positions
+	 * of record titles are detected here.
+	 */
+	if (fs->is_valid && !desc->is_expanded_mode &&
+		fs->srcx == srcx &&
+		fs->vcursor_xmin == vcursor_xmin &&
+		fs->vcursor_xmax == vcursor_xmax &&
+		abs(srcy_bak - fs->srcy) < maxy)
+	{
+		int		scroll = srcy_bak - fs->srcy;
+
+		is_partial = true;
+		old_cursor_row = fs->cursor_row - scroll;
+
+		if (scroll > 0)
+		{
+			new_rows_from = maxy - scroll;
+			new_rows_to = maxy;
+		}
+		else
+		{
+			new_rows_from = 0;
+			new_rows_to = -scroll;
+		}
+
+		if (scroll != 0)
+		{
+			scrollok(win, TRUE);
+			wscrl(win, scroll);
+			scrollok(win, FALSE);
+		}
+		else if (old_cursor_row == cursor_row)
+			return;
+	}
+
+	fs->is_valid = true;
+	fs->srcy = srcy_bak;
+	fs->srcx = srcx;
+	fs->cursor_row = cursor_row;
+	fs->vcursor_xmin = vcursor_xmin;
+	fs->vcursor_xmax = vcursor_xmax;
+
 	while (row < maxy )
 	{
 		int			bytes;
 		char	   *ptr;
 		char	   *rowstr = NULL;
+		LineBuffer *row_lnb = NULL;
+		int			row_lnb_row = 0;
 		bool		line_is_valid = false;
-		LineInfo   *lineinfo = NULL;
+		SearchInfo *searchinfo = NULL;
+		int			start_char = 0;
+		bool		is_found_multi = false;
 		bool		is_bookmark_row = false;
 		bool		is_cursor_row = false;
 		bool		is_found_row = false;
@@ -219,7 +594,8 @@ window_fill(int window_identifier,
 				lnb = mp->lnb;
 				lnb_row = mp->lnb_row;
 				rowstr = lnb->rows[lnb_row];
-				lineinfo = lnb->lineinfo ? &lnb->lineinfo[lnb_row] : NULL;
+				row_lnb = lnb;
+				row_lnb_row = lnb_row;
 
 				line_is_valid = true;
 			}
@@ -235,16 +611,23 @@ window_fill(int window_identifier,
 			if (lnb != NULL && lnb_row < lnb->nrows)
 			{
 				rowstr = lnb->rows[lnb_row];
-				if (lnb->lineinfo != NULL)
-					lineinfo = &lnb->lineinfo[lnb_row];
-				else
-					lineinfo = NULL;
+				row_lnb = lnb;
+				row_lnb_row = lnb_row;
 				lnb_row += 1;
 
 				line_is_valid = true;
 			}
 		}
 
+		/* unchanged rows are not drawn again */
+		if (is_partial &&
+			(row < new_rows_from || row >= new_rows_to) &&
+			row != cursor_row && row != old_cursor_row)
+		{
+			row += 1;
+			continue;
+		}
+
 		/* when rownum is printed, don't process original text */
 		if (is_rownum && line_is_valid)
 		{
@@ -254,99 +637,134 @@ window_fill(int window_identifier,
 			rowstr = buffer;
 		}
 
-		is_bookmark_row = (lineinfo != NULL && (lineinfo->mask & LINEINFO_BOOKMARK) != 0) ? true : false;
+		is_bookmark_row = row_lnb != NULL && row_lnb->bookmarks &&
+						  LINEINFO_IS_SET(row_lnb->bookmarks, row_lnb_row);
 
-		if (!is_fix_rows && *scrdesc->searchterm != '\0' && lnb != NULL &&  rowstr != NULL
-					  && !opts->no_highlight_search)
+		if (!is_fix_rows && *scrdesc->searchterm != '\0' && row_lnb != NULL &&  rowstr != NULL
+					  && !opts->no_highlight_search
+					  && !(is_footer && scrdesc->search_column > 0))
 		{
-			if (lineinfo == NULL)
-			{
-				int		i;
-
-				lnb->lineinfo = malloc(1000 * sizeof(LineInfo));
-				if (lnb->lineinfo == NULL)
-					leave_ncurses("out of memory");
-
-				memset(lnb->lineinfo, 0, 1000 * sizeof(LineInfo));
+			searchinfo = get_searchinfo(row_lnb);
 
-				for (i = 0; i < lnb->nrows; i++)
-					lnb->lineinfo[i].mask = LINEINFO_UNKNOWN;
-
-				lineinfo = &lnb->lineinfo[lnb_row - 1];
-			}
-
-			if (lineinfo->mask & LINEINFO_UNKNOWN)
+			if (!LINEINFO_IS_SET(searchinfo->searched, row_lnb_row))
 			{
 				const char *str = rowstr;
+				SearchMatch *matches;
+				int			nmatches;
 
-				lineinfo->mask ^= LINEINFO_UNKNOWN;
-				lineinfo->mask &= ~(LINEINFO_FOUNDSTR | LINEINFO_FOUNDSTR_MULTI);
+				LINEINFO_SET(searchinfo->searched, row_lnb_row);
 
-				while (str != NULL)
+				/* use positions from search index, when the row is indexed already */
+				if (!is_rownum &&
+					search_index_row(opts, scrdesc, desc, row + srcy_bak, &matches, &nmatches))
 				{
-					/*
-					 * When we would to ignore case or lower case (in this case, we know, so
-					 * pattern has not any upper char, then we have to use slower case insensitive
-					 * searching.
-					 */
-					if (opts->ignore_case || (opts->ignore_lower_case && !scrdesc->has_upperchr))
+					if (nmatches > 0)
 					{
-						if (opts->force8bit)
-							str = nstrstr(str, scrdesc->searchterm);
-						else
-							str = utf8_nstrstr(str, scrdesc->searchterm);
-					}
-					else if (opts->ignore_lower_case && scrdesc->has_upperchr)
-					{
-						if (opts->force8bit)
-							str = nstrstr_ignore_lower_case(str, scrdesc->searchterm);
-						else
-							str = utf8_nstrstr_ignore_lower_case(str, scrdesc->searchterm);
+						LINEINFO_SET(searchinfo->found, row_lnb_row);
+						set_start_char(searchinfo, row_lnb_row, matches[0].start_x);
+
+						if (nmatches > 1 || opts->regex_search)
+							LINEINFO_SET(searchinfo->found_multi, row_lnb_row);
 					}
-					else
-						/* we can use case sensitive searching (binary comparation) */
-						str = strstr(str, scrdesc->searchterm);
+
+					str = NULL;
+				}
+
+				while (str != NULL)
+				{
+					int		size;
+
+					str = pspg_search(opts, scrdesc, desc, row_lnb, row_lnb_row, rowstr, str, &size);
 
 					if (str != NULL)
 					{
-						if (lineinfo->mask & LINEINFO_FOUNDSTR)
+						if (LINEINFO_IS_SET(searchinfo->found, row_lnb_row))
 						{
 							/* When we detect multi occurrence, then stop searching */
-							lineinfo->mask |= LINEINFO_FOUNDSTR_MULTI;
+							LINEINFO_SET(searchinfo->found_multi, row_lnb_row);
 							break;
 						}
 						else
 						{
-							lineinfo->mask |= LINEINFO_FOUNDSTR;
-							if (opts->force8bit)
-								lineinfo->start_char = str - rowstr;
-							else
-								lineinfo->start_char = utf8len_start_stop(rowstr, str);
+							LINEINFO_SET(searchinfo->found, row_lnb_row);
+							set_start_char(searchinfo, row_lnb_row,
+										   opts->force8bit ?
+												str - rowstr :
+												utf8len_start_stop(rowstr, str));
+
+							/* matches of regular expression have variable size */
+							if (opts->regex_search)
+							{
+								LINEINFO_SET(searchinfo->found_multi, row_lnb_row);
+								break;
+							}
 						}
 
-						str += scrdesc->searchterm_size;
+						str += size;
 					}
 				}
 			}
 		}
 
-		is_pattern_row = (lineinfo != NULL && (lineinfo->mask & LINEINFO_FOUNDSTR) != 0) ? true : false;
+		searchinfo = row_lnb != NULL ? row_lnb->searchinfo : NULL;
+
+		if (searchinfo && LINEINFO_IS_SET(searchinfo->found, row_lnb_row))
+		{
+			is_pattern_row = true;
+			is_found_multi = LINEINFO_IS_SET(searchinfo->found_multi, row_lnb_row);
+			start_char = get_start_char(searchinfo, row_lnb_row);
+		}
 
 		/* prepare position cache, when first occurrence is visible */
-		if (lineinfo != NULL && (lineinfo->mask & LINEINFO_FOUNDSTR_MULTI) != 0 &&
-			  srcx + maxx > lineinfo->start_char &&
+		if (is_found_multi &&
+			  srcx + maxx > start_char &&
 			  *scrdesc->searchterm != '\0')
 		{
 			const char *str = rowstr;
+			SearchMatch *matches;
+			int			nmatches;
+
+			/* matches of indexed rows are not searched again */
+			if (!is_rownum &&
+				search_index_row(opts, scrdesc, desc, row + srcy_bak, &matches, &nmatches))
+			{
+				int		i;
+
+				for (i = 0; i < nmatches && npositions < 100; i++)
+				{
+					/* skip matches before visible part */
+					if (matches[i].end_x <= srcx)
+						continue;
+
+					positions[npositions][0] = matches[i].start_x;
+					positions[npositions][1] = matches[i].end_x;
+					npositions += 1;
+
+					if (matches[i].end_x > srcx + maxx)
+						break;
+				}
+
+				str = NULL;
+			}
 
 			while (str != NULL && npositions < 100)
 			{
-				str = pspg_search(opts, scrdesc, str);
+				int		size;
+
+				str = pspg_search(opts, scrdesc, desc, row_lnb, row_lnb_row, rowstr, str, &size);
 
 				if (str != NULL)
 				{
-					positions[npositions][0] = opts->force8bit ? str - rowstr : utf8len_start_stop(rowstr, str);
-					positions[npositions][1] = positions[npositions][0] + scrdesc->searchterm_char_size;
+					if (opts->force8bit)
+					{
+						positions[npositions][0] = str - rowstr;
+						positions[npositions][1] = positions[npositions][0] + size;
+					}
+					else
+					{
+						positions[npositions][0] = utf8len_start_stop(rowstr, str);
+						positions[npositions][1] = positions[npositions][0] + utf8len_start_stop(str, str + size);
+					}
 
 					/* don't search more if we are over visible part */
 					if (positions[npositions][1] > srcx + maxx)
@@ -355,7 +773,7 @@ window_fill(int window_identifier,
 						break;
 					}
 
-					str += scrdesc->searchterm_size;
+					str += size;
 					npositions += 1;
 				}
 			}
@@ -461,38 +879,8 @@ window_fill(int window_identifier,
 			}
 
 			/* skip first srcx chars */
-			i = srcx;
-			left_spaces = 0;
-			if (opts->force8bit)
-			{
-				while(i > 0)
-				{
-					if (*rowstr != '\0' && *rowstr != '\n')
-					{
-						i -= 1;
-						rowstr += 1;
-						if (i < 0)
-							left_spaces = -i;
-					}
-					else
-						break;
-				}
-			}
-			else
-			{
-				while(i > 0)
-				{
-					if (*rowstr != '\0' && *rowstr != '\n')
-					{
-						i -= utf_dsplen(rowstr);
-						rowstr += utf8charlen(*rowstr);
-						if (i < 0)
-							left_spaces = -i;
-					}
-					else
-						break;
-				}
-			}
+			rowstr = skip_display_chars(opts, desc, rowstr, row_lnb, row_lnb_row,
+										srcx, &left_spaces);
 
 			/* Fix too hungry cutting when some multichar char is removed */
 			if (left_spaces > 0)
@@ -608,9 +996,9 @@ window_fill(int window_identifier,
 							else if (pos < desc->headline_char_size)
 								new_attr = column_format == 'd' ? t->pattern_data_attr : t->pattern_line_attr;
 
-							if ((new_attr == t->pattern_data_attr || new_attr == t->pattern_vertical_cursor_attr) && pos >= lineinfo->start_char)
+							if ((new_attr == t->pattern_data_attr || new_attr == t->pattern_vertical_cursor_attr) && pos >= start_char)
 							{
-								if ((lineinfo->mask & LINEINFO_FOUNDSTR_MULTI) != 0)
+								if (is_found_multi)
 								{
 									int		j;
 
@@ -625,7 +1013,7 @@ window_fill(int window_identifier,
 								}
 								else
 								{
-									if (pos < lineinfo->start_char + scrdesc->searchterm_char_size)
+									if (pos < start_char + scrdesc->searchterm_char_size)
 										new_attr = t->found_str_attr;
 								}
 							}
@@ -643,11 +1031,11 @@ window_fill(int window_identifier,
 						if (is_cursor || is_cross_cursor)
 						{
 							if (is_found_row && pos >= scrdesc->found_start_x &&
-									pos < scrdesc->found_start_x + scrdesc->searchterm_char_size)
+									pos < scrdesc->found_start_x + scrdesc->found_char_size)
 								new_attr = new_attr ^ ( A_REVERSE | pattern_fix );
-							else if (is_pattern_row && pos >= lineinfo->start_char)
+							else if (is_pattern_row && pos >= start_char)
 							{
-								if ((lineinfo->mask & LINEINFO_FOUNDSTR_MULTI) != 0)
+								if (is_found_multi)
 								{
 									int		j;
 
@@ -662,7 +1050,7 @@ window_fill(int window_identifier,
 								}
 								else
 								{
-									if (pos < lineinfo->start_char + scrdesc->searchterm_char_size)
+									if (pos < start_char + scrdesc->searchterm_char_size)
 										new_attr = t->cursor_pattern_attr;
 								}
 							}
@@ -832,6 +1220,9 @@ window_fill(int window_identifier,
 
 		wattroff(win, active_attr);
 	}
+
+	if (is_fix_rows)
+		draw_sort_marks(win, srcy_bak, srcx, desc, t, opts);
 }
 
 #ifdef COLORIZED_NO_ALTERNATE_SCREEN
@@ -876,11 +1267,125 @@ ansi_attr(attr_t attr)
 
 }
 
+/*
+ * Output of draw_data is collected in one buffer, and it is written by
+ * one write call. The last sent attribute is tracked, so only changes
+ * of attributes are sent.
+ */
+typedef struct
+{
+	char   *data;
+	int		size;
+	int		allocated;
+	char	attr[20];				/* last sent SGR sequence */
+	bool	attr_is_valid;			/* false, when state of terminal is unknown */
+} OutputBuffer;
+
+static void
+ob_append(OutputBuffer *ob, const char *str, int size)
+{
+	if (ob->size + size > ob->allocated)
+	{
+		int		new_allocated = ob->allocated > 0 ? ob->allocated : 64 * 1024;
+
+		while (ob->size + size > new_allocated)
+			new_allocated *= 2;
+
+		ob->data = realloc(ob->data, new_allocated);
+		if (!ob->data)
+			leave_ncurses("out of memory");
+
+		ob->allocated = new_allocated;
+	}
+
+	memcpy(ob->data + ob->size, str, size);
+	ob->size += size;
+}
+
+static void
+ob_puts(OutputBuffer *ob, const char *str)
+{
+	ob_append(ob, str, strlen(str));
+}
+
+static void
+ob_printf(OutputBuffer *ob, const char *fmt, ...)
+{
+	char		buffer[64];
+	va_list		args;
+	int			size;
+
+	va_start(args, fmt);
+	size = vsnprintf(buffer, sizeof(buffer), fmt, args);
+	va_end(args);
+
+	if (size > 0)
+		ob_append(ob, buffer, size < (int) sizeof(buffer) ? size : (int) sizeof(buffer) - 1);
+}
+
+/*
+ * Sends attribute only when it is different than last sent attribute.
+ */
+static void
+ob_set_attr(OutputBuffer *ob, attr_t attr)
+{
+	char	   *str = ansi_attr(attr);
+
+	if (ob->attr_is_valid && strcmp(ob->attr, str) == 0)
+		return;
+
+	ob_puts(ob, str);
+
+	strncpy(ob->attr, str, sizeof(ob->attr) - 1);
+	ob->attr[sizeof(ob->attr) - 1] = '\0';
+	ob->attr_is_valid = true;
+}
+
+/*
+ * Restore (and save again) cursor position. Attributes are restored too,
+ * so the last sent attribute is not known after.
+ */
+static void
+ob_restore_cursor(OutputBuffer *ob)
+{
+	ob_puts(ob, "\e8\e7");
+	ob->attr_is_valid = false;
+}
+
+static void
+ob_flush(OutputBuffer *ob)
+{
+	char	   *ptr = ob->data;
+	int			size = ob->size;
+
+	/* stdout can hold some data still */
+	fflush(stdout);
+
+	while (size > 0)
+	{
+		ssize_t		n = write(STDOUT_FILENO, ptr, size);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		ptr += n;
+		size -= n;
+	}
+
+	ob->size = 0;
+}
+
 /*
  * Print data to primary screen without ncurses
  */
 static void
-draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
+draw_rectange(OutputBuffer *ob,
+			int offsety, int offsetx,			/* y, x offset on screen */
 			int maxy, int maxx,				/* size of visible rectangle */
 			int srcy, int srcx,				/* offset to displayed data */
 			Options *opts,
@@ -907,13 +1412,15 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 	row = 0;
 
 	if (offsety)
-		printf("\e[%dB", offsety);
+		ob_printf(ob, "\e[%dB", offsety);
 
 	while (row < maxy)
 	{
 		int			bytes;
 		char	   *ptr;
 		char	   *rowstr = NULL;
+		LineBuffer *row_lnb = NULL;
+		int			row_lnb_row = 0;
 
 		if (desc->order_map)
 		{
@@ -926,6 +1433,8 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 				lnb = mp->lnb;
 				lnb_row = mp->lnb_row;
 				rowstr = lnb->rows[lnb_row];
+				row_lnb = lnb;
+				row_lnb_row = lnb_row;
 			}
 		}
 		else
@@ -939,12 +1448,14 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 			if (lnb != NULL && lnb_row < lnb->nrows)
 			{
 				rowstr = lnb->rows[lnb_row];
+				row_lnb = lnb;
+				row_lnb_row = lnb_row;
 				lnb_row += 1;
 			}
 		}
 
 		active_attr = line_attr;
-		printf("%s", ansi_attr(active_attr));
+		ob_set_attr(ob, active_attr);
 
 		row += 1;
 
@@ -972,41 +1483,11 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 			}
 
 			if (offsetx != 0)
-				printf("\e[%dC", offsetx);
+				ob_printf(ob, "\e[%dC", offsetx);
 
 			/* skip first srcx chars */
-			i = srcx;
-			left_spaces = 0;
-			if (opts->force8bit)
-			{
-				while(i > 0)
-				{
-					if (*rowstr != '\0' && *rowstr != '\n')
-					{
-						i -= 1;
-						rowstr += 1;
-						if (i < 0)
-							left_spaces = -i;
-					}
-					else
-						break;
-				}
-			}
-			else
-			{
-				while(i > 0)
-				{
-					if (*rowstr != '\0' && *rowstr != '\n')
-					{
-						i -= utf_dsplen(rowstr);
-						rowstr += utf8charlen(*rowstr);
-						if (i < 0)
-							left_spaces = -i;
-					}
-					else
-						break;
-				}
-			}
+			rowstr = skip_display_chars(opts, desc, rowstr, row_lnb, row_lnb_row,
+										srcx, &left_spaces);
 
 			/* Fix too hungry cutting when some multichar char is removed */
 			if (left_spaces > 0)
@@ -1052,14 +1533,14 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 						{
 							if (bytes > 0)
 							{
-								printf("%.*s", bytes, rowstr);
+								ob_append(ob, rowstr, bytes);
 								rowstr += bytes;
 								bytes = 0;
 							}
 
 							/* active new style */
 							active_attr = new_attr;
-							printf("%s", ansi_attr(active_attr));
+							ob_set_attr(ob, active_attr);
 						}
 					}
 					else if (!fix_line_attr_style && desc->headline_transl != NULL)
@@ -1075,14 +1556,14 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 								if (bytes > 0)
 								{
 									//waddnstr(win, rowstr, bytes);
-									printf("%.*s", bytes, rowstr);
+									ob_append(ob, rowstr, bytes);
 									rowstr += bytes;
 									bytes = 0;
 								}
 
 								/* active new style */
 								active_attr = new_attr;
-								printf("%s", ansi_attr(active_attr));
+								ob_set_attr(ob, active_attr);
 							}
 						}
 					}
@@ -1101,10 +1582,10 @@ draw_rectange(int offsety, int offsetx,			/* y, x offset on screen */
 
 			if (bytes > 0)
 			{
-				printf("%.*s", bytes, rowstr);
+				ob_append(ob, rowstr, bytes);
 				if (clreoln)
-					printf("\e[K");
-				printf("\n");
+					ob_puts(ob, "\e[K");
+				ob_puts(ob, "\n");
 			}
 
 			if (free_row != NULL)
@@ -1125,23 +1606,26 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 {
 	struct winsize size;
 	int		i;
+	OutputBuffer ob;
+
+	memset(&ob, 0, sizeof(OutputBuffer));
 
 	if (ioctl(0, TIOCGWINSZ, (char *) &size) >= 0)
 	{
 		for (i = 0; i < min_int(size.ws_row - 1 - scrdesc->top_bar_rows, desc->last_row + 1); i++)
-			printf("\eD");
+			ob_puts(&ob, "\eD");
 
 		/* Go wit cursor to up */
-		printf("\e[%dA", min_int(size.ws_row - 1 - scrdesc->top_bar_rows, desc->last_row + 1));
+		ob_printf(&ob, "\e[%dA", min_int(size.ws_row - 1 - scrdesc->top_bar_rows, desc->last_row + 1));
 
 		/*
 		 * Save cursor - Attention, there are a Fedora29 bug, and it doesn't work
 		 */
-		printf("\e7");
+		ob_puts(&ob, "\e7");
 
 		if (scrdesc->fix_cols_cols > 0)
 		{
-			draw_rectange(scrdesc->fix_rows_rows, 0,
+			draw_rectange(&ob, scrdesc->fix_rows_rows, 0,
 						  scrdesc->rows_rows, scrdesc->fix_cols_cols,
 						  first_data_row + first_row - fix_rows_offset, 0,
 						  opts, desc,
@@ -1152,9 +1636,9 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 		if (scrdesc->fix_rows_rows > 0 )
 		{
 			/* Go to saved position */
-			printf("\e8\e7");
+			ob_restore_cursor(&ob);
 
-			draw_rectange(0, scrdesc->fix_cols_cols,
+			draw_rectange(&ob, 0, scrdesc->fix_cols_cols,
 						  scrdesc->fix_rows_rows, size.ws_col - scrdesc->fix_cols_cols,
 						  desc->title_rows + fix_rows_offset, scrdesc->fix_cols_cols + cursor_col,
 						  opts, desc,
@@ -1165,9 +1649,9 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 		if (scrdesc->fix_rows_rows > 0 && scrdesc->fix_cols_cols > 0)
 		{
 			/* Go to saved position */
-			printf("\e8\e7");
+			ob_restore_cursor(&ob);
 
-			draw_rectange(0, 0,
+			draw_rectange(&ob, 0, 0,
 						  scrdesc->fix_rows_rows, scrdesc->fix_cols_cols,
 						  desc->title_rows + fix_rows_offset, 0,
 						  opts, desc,
@@ -1178,9 +1662,9 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 		if (scrdesc->rows_rows > 0)
 		{
 			/* Go to saved position */
-			printf("\e8\e7");
+			ob_restore_cursor(&ob);
 
-			draw_rectange(scrdesc->fix_rows_rows, scrdesc->fix_cols_cols,
+			draw_rectange(&ob, scrdesc->fix_rows_rows, scrdesc->fix_cols_cols,
 						  scrdesc->rows_rows, size.ws_col - scrdesc->fix_cols_cols,
 						  first_data_row + first_row - fix_rows_offset, scrdesc->fix_cols_cols + cursor_col,
 						  opts, desc,
@@ -1193,9 +1677,9 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 		if (w_footer(scrdesc) != NULL)
 		{
 			/* Go to saved position */
-			printf("\e8\e7");
+			ob_restore_cursor(&ob);
 
-			draw_rectange(scrdesc->fix_rows_rows + scrdesc->rows_rows, 0,
+			draw_rectange(&ob, scrdesc->fix_rows_rows + scrdesc->rows_rows, 0,
 						  scrdesc->footer_rows, scrdesc->maxx,
 						  first_data_row + first_row + scrdesc->rows_rows - fix_rows_offset, footer_cursor_col,
 						  opts, desc,
@@ -1203,6 +1687,9 @@ draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 		}
 
 		/* reset */
-		printf("\e[0m\r");
+		ob_puts(&ob, "\e[0m\r");
+		ob_flush(&ob);
 	}
+
+	free(ob.data);
 }
@@ -0,0 +1,395 @@
+/*-------------------------------------------------------------------------
+ *
+ * profile.c
+ *	  scripted commands and frame time profiler used by --bench-render
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/profile.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "commands.h"
+#include "pspg.h"
+
+/*
+ * One line of script: command name, optional repeat count "xN" and
+ * optional argument (used instead of user's input, when the command
+ * requires some string - search pattern, line number, ...).
+ */
+typedef struct
+{
+	int		command;
+	int		repeat;
+	char   *arg;
+} ScriptStep;
+
+static ScriptStep *script_steps = NULL;
+static int	script_nsteps = 0;
+static int	script_step = 0;
+static int	script_repeat = 0;
+static const char *script_arg = NULL;
+
+/*
+ * Times of one frame are summed in current_times, and they are saved
+ * to samples, when the frame is displayed.
+ */
+typedef struct
+{
+	double *samples;				/* time in ms */
+	int		nsamples;
+	int		allocated;
+} ProfileSamples;
+
+static const char *profile_counter_names[] = {
+	"window_fill", "print_status", "refresh", "frame"
+};
+
+bool		profile_active = false;
+
+static ProfileSamples profile_samples[PROFILE_COUNTERS];
+static double current_times[PROFILE_COUNTERS];
+static double start_times[PROFILE_COUNTERS];
+static double last_frame_end = 0.0;
+
+static double
+current_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+}
+
+/*
+ * Returns command with name (case insensitive), or cmd_Invalid.
+ */
+static int
+command_by_name(const char *name)
+{
+	int		cmd;
+
+	for (cmd = cmd_ReleaseCols; cmd <= cmd_TogglePause; cmd++)
+	{
+		if (strcasecmp(cmd_string(cmd), name) == 0)
+			return cmd;
+	}
+
+	return cmd_Invalid;
+}
+
+/*
+ * Reads script of commands. Empty lines and lines starting by # are
+ * ignored. Returns false and message in errbuf on error.
+ */
+bool
+bench_script_load(const char *path, char *errbuf, int errbuf_size)
+{
+	FILE	   *fp;
+	char	   *line = NULL;
+	size_t		len = 0;
+	int			allocated = 0;
+	int			lineno = 0;
+
+	fp = fopen(path, "r");
+	if (!fp)
+	{
+		snprintf(errbuf, errbuf_size, "cannot to open script \"%s\"", path);
+		return false;
+	}
+
+	while (getline(&line, &len, fp) != -1)
+	{
+		ScriptStep *step;
+		char	   *ptr = line;
+		char	   *name;
+		char	   *end;
+
+		lineno += 1;
+
+		/* remove trailing new line and spaces */
+		end = line + strlen(line);
+		while (end > line && isspace((unsigned char) end[-1]))
+			*--end = '\0';
+
+		while (isspace((unsigned char) *ptr))
+			ptr += 1;
+
+		if (*ptr == '\0' || *ptr == '#')
+			continue;
+
+		if (script_nsteps >= allocated)
+		{
+			allocated = allocated > 0 ? allocated * 2 : 64;
+			script_steps = realloc(script_steps, allocated * sizeof(ScriptStep));
+			if (!script_steps)
+				leave_ncurses("out of memory");
+		}
+
+		step = &script_steps[script_nsteps];
+
+		name = ptr;
+		while (*ptr && !isspace((unsigned char) *ptr))
+			ptr += 1;
+		if (*ptr)
+			*ptr++ = '\0';
+
+		step->command = command_by_name(name);
+		if (step->command == cmd_Invalid)
+		{
+			snprintf(errbuf, errbuf_size, "unknown command \"%s\" on line %d of script", name, lineno);
+			fclose(fp);
+			free(line);
+			return false;
+		}
+
+		while (isspace((unsigned char) *ptr))
+			ptr += 1;
+
+		step->repeat = 1;
+
+		if (*ptr == 'x' && isdigit((unsigned char) ptr[1]))
+		{
+			step->repeat = strtol(ptr + 1, &end, 10);
+			if (step->repeat <= 0 || (*end != '\0' && !isspace((unsigned char) *end)))
+			{
+				snprintf(errbuf, errbuf_size, "invalid repeat count on line %d of script", lineno);
+				fclose(fp);
+				free(line);
+				return false;
+			}
+
+			ptr = end;
+			while (isspace((unsigned char) *ptr))
+				ptr += 1;
+		}
+
+		if (*ptr)
+		{
+			step->arg = strdup(ptr);
+			if (!step->arg)
+				leave_ncurses("out of memory");
+		}
+		else
+			step->arg = NULL;
+
+		script_nsteps += 1;
+	}
+
+	fclose(fp);
+	free(line);
+
+	script_step = 0;
+	script_repeat = 0;
+
+	return true;
+}
+
+/*
+ * Returns next command of script or cmd_Invalid, when the script is
+ * processed. The argument of the command is available by
+ * bench_script_get_arg.
+ */
+int
+bench_script_next(void)
+{
+	ScriptStep *step;
+
+	if (script_step < script_nsteps &&
+		script_repeat >= script_steps[script_step].repeat)
+	{
+		script_step += 1;
+		script_repeat = 0;
+	}
+
+	if (script_step >= script_nsteps)
+	{
+		script_arg = NULL;
+		return cmd_Invalid;
+	}
+
+	step = &script_steps[script_step];
+	script_repeat += 1;
+	script_arg = step->arg;
+
+	return step->command;
+}
+
+/*
+ * Copy argument of current command to buffer. The argument can be used
+ * only once.
+ */
+void
+bench_script_get_arg(char *buffer, int maxsize)
+{
+	if (script_arg)
+	{
+		strncpy(buffer, script_arg, maxsize);
+		buffer[maxsize] = '\0';
+	}
+	else
+		buffer[0] = '\0';
+
+	script_arg = NULL;
+}
+
+void
+profile_begin(ProfileCounter counter)
+{
+	if (profile_active)
+		start_times[counter] = current_ms();
+}
+
+void
+profile_end(ProfileCounter counter)
+{
+	if (profile_active)
+		current_times[counter] += current_ms() - start_times[counter];
+}
+
+static void
+add_sample(ProfileSamples *ps, double value)
+{
+	if (ps->nsamples >= ps->allocated)
+	{
+		ps->allocated = ps->allocated > 0 ? ps->allocated * 2 : 1024;
+		ps->samples = realloc(ps->samples, ps->allocated * sizeof(double));
+		if (!ps->samples)
+			leave_ncurses("out of memory");
+	}
+
+	ps->samples[ps->nsamples++] = value;
+}
+
+/*
+ * Saves times of displayed frame. The time of frame is time from end
+ * of previous frame (so it includes processing of command too).
+ */
+void
+profile_frame_end(void)
+{
+	double		now;
+	int			i;
+
+	if (!profile_active)
+		return;
+
+	now = current_ms();
+
+	current_times[PROFILE_FRAME] = last_frame_end > 0 ? now - last_frame_end : 0.0;
+
+	/* first frame is initial drawing of screen */
+	if (last_frame_end > 0)
+	{
+		for (i = 0; i < PROFILE_COUNTERS; i++)
+			add_sample(&profile_samples[i], current_times[i]);
+	}
+
+	for (i = 0; i < PROFILE_COUNTERS; i++)
+		current_times[i] = 0.0;
+
+	last_frame_end = now;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double		d1 = *((const double *) a);
+	double		d2 = *((const double *) b);
+
+	return d1 < d2 ? -1 : (d1 > d2 ? 1 : 0);
+}
+
+static double
+percentile(ProfileSamples *ps, int p)
+{
+	int		i = (int) ((long) (ps->nsamples - 1) * p / 100);
+
+	return ps->samples[i];
+}
+
+/*
+ * Prints p50, p99 and max of every counter and histogram of frame times.
+ */
+void
+profile_report(FILE *fp)
+{
+	static const double bounds[] = {0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500};
+	int		nbounds = sizeof(bounds) / sizeof(double);
+	int		histogram[sizeof(bounds) / sizeof(double) + 1];
+	ProfileSamples *frames = &profile_samples[PROFILE_FRAME];
+	int		maxcount = 0;
+	int		i, j;
+
+	fprintf(fp, "frames: %d\n\n", frames->nsamples);
+
+	if (frames->nsamples == 0)
+		return;
+
+	fprintf(fp, "%-14s %10s %10s %10s %12s\n", "ms", "p50", "p99", "max", "total");
+
+	for (i = 0; i < PROFILE_COUNTERS; i++)
+	{
+		ProfileSamples *ps = &profile_samples[i];
+		double		total = 0.0;
+
+		for (j = 0; j < ps->nsamples; j++)
+			total += ps->samples[j];
+
+		qsort(ps->samples, ps->nsamples, sizeof(double), cmp_double);
+
+		fprintf(fp, "%-14s %10.3f %10.3f %10.3f %12.1f\n",
+				profile_counter_names[i],
+				percentile(ps, 50),
+				percentile(ps, 99),
+				ps->samples[ps->nsamples - 1],
+				total);
+	}
+
+	memset(histogram, 0, sizeof(histogram));
+
+	for (i = 0; i < frames->nsamples; i++)
+	{
+		for (j = 0; j < nbounds; j++)
+			if (frames->samples[i] < bounds[j])
+				break;
+
+		histogram[j] += 1;
+	}
+
+	for (j = 0; j <= nbounds; j++)
+		if (histogram[j] > maxcount)
+			maxcount = histogram[j];
+
+	fprintf(fp, "\nframe time histogram:\n");
+
+	for (j = 0; j <= nbounds; j++)
+	{
+		int		width;
+
+		if (histogram[j] == 0)
+			continue;
+
+		if (j < nbounds)
+			fprintf(fp, "  < %6.1f ms %8d  ", bounds[j], histogram[j]);
+		else
+			fprintf(fp, " >= %6.1f ms %8d  ", bounds[nbounds - 1], histogram[j]);
+
+		width = (int) ((long) histogram[j] * 50 / maxcount);
+		while (width-- > 0)
+			fputc('#', fp);
+
+		fputc('\n', fp);
+	}
+}
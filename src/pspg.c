@@ -38,6 +38,8 @@
 #include <libgen.h>
 #include <locale.h>
 #include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #include <sys/ioctl.h>
 
@@ -113,7 +115,17 @@ static attr_t	input_attr;
 #endif
 
 static bool		handle_sigint = false;
+
+/*
+ * The waiting on input is implemented by poll on terminal input and on
+ * signal pipe. The signal handler writes to signal pipe, so the waiting
+ * cannot to miss the signal. Other sources of events can be added to
+ * poll set in wait_for_event.
+ */
+static int		input_fd = -1;
+static int		signal_pipe[2] = {-1, -1};
 static char		last_row_search[256];
+static char		last_filter[256];
 static char		last_col_search[256];
 static char		last_line[256];
 static char		last_path[1025];
@@ -124,6 +136,45 @@ static char		last_history[256];
 
 #endif
 
+/*
+ * State of incremental search. The position of cursor and the previous
+ * search term are saved before search prompt is displayed. After any change
+ * of pattern, the rows are searched from saved cursor position, and the
+ * first match is displayed. The searching is limited by time budget, and
+ * it is canceled, when next key is pressed.
+ */
+typedef struct
+{
+	Options	   *opts;
+	ScrDesc	   *scrdesc;
+	DataDesc   *desc;
+	bool		backward;
+	int			search_column;
+	int			fd;					/* fd used for detection of pending keys */
+	int			first_data_row;
+	int			first_row;
+	int			cursor_row;
+	int			cursor_col;
+	int			footer_cursor_col;
+	int			fix_rows_offset;
+	char		pattern[256];		/* last processed pattern */
+	bool		canceled;			/* true, when last searching was canceled */
+	bool		changed;			/* true, when scrdesc was changed by preview */
+	ScrDesc		saved;				/* search related fields of scrdesc */
+} IncSearchState;
+
+static IncSearchState *incsearch = NULL;
+
+#define INCSEARCH_TIME_BUDGET		50		/* in ms */
+
+/*
+ * When some input is waiting after command that only moves cursor, then
+ * the drawing is skipped, so only the result of all waiting commands is
+ * displayed. But the screen is refreshed at least after this time, so
+ * the movement is visible when some key is held down.
+ */
+#define MAX_FRAME_INTERVAL			50		/* in ms */
+
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
 #define		USE_EXTENDED_NAMES
@@ -149,13 +200,100 @@ static bool active_ncurses = false;
 static int number_width(int num);
 static int get_event(MEVENT *mevent, bool *alt, bool *sigint, int timeout);
 static char * tilde(char *path);
+static void reset_searching_lineinfo(ScrDesc *scrdesc, LineBuffer *lnb);
+static void current_time(time_t *sec, long *ms);
+static bool is_line_continuation_char(char *str, DataDesc *desc);
 
 static void
 SigintHandler(int sig_num)
 {
+	int		saved_errno = errno;
+
 	signal(SIGINT, SigintHandler);
 
 	handle_sigint = true;
+
+	/* wake up waiting on events */
+	if (signal_pipe[1] != -1)
+		(void) write(signal_pipe[1], "", 1);
+
+	errno = saved_errno;
+}
+
+/*
+ * The trace is written, when pspg is waiting on next event.
+ */
+static void
+SigusrHandler(int sig_num)
+{
+	int		saved_errno = errno;
+
+	trace_dump_requested = true;
+
+	if (signal_pipe[1] != -1)
+		(void) write(signal_pipe[1], "", 1);
+
+	errno = saved_errno;
+}
+
+/*
+ * Creates nonblocking pipe used for wake up from waiting on events
+ * from signal handler.
+ */
+static void
+init_signal_pipe(void)
+{
+	int		i;
+
+	if (pipe(signal_pipe) != 0)
+	{
+		signal_pipe[0] = signal_pipe[1] = -1;
+		return;
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		fcntl(signal_pipe[i], F_SETFL, fcntl(signal_pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+}
+
+/*
+ * Waits on terminal input or signal. timeoutval is in ms, -1 means
+ * waiting without timeout. Returns false after timeout. There are not
+ * any periodic wakeups, so idle pspg doesn't consume CPU.
+ */
+static bool
+wait_for_event(int timeoutval)
+{
+	struct pollfd	fds[2];
+	int		nfds = 0;
+	int		result;
+
+	fds[nfds].fd = input_fd;
+	fds[nfds].events = POLLIN;
+	fds[nfds++].revents = 0;
+
+	if (signal_pipe[0] != -1)
+	{
+		fds[nfds].fd = signal_pipe[0];
+		fds[nfds].events = POLLIN;
+		fds[nfds++].revents = 0;
+	}
+
+	result = poll(fds, nfds, timeoutval);
+
+	/* clean signal pipe */
+	if (result > 0 && nfds > 1 && (fds[1].revents & POLLIN))
+	{
+		char	buffer[64];
+
+		while (read(signal_pipe[0], buffer, sizeof(buffer)) > 0)
+			;
+	}
+
+	/* interrupted by signal (like SIGWINCH) is not timeout */
+	return result != 0;
 }
 
 int
@@ -339,36 +477,51 @@ nstrstr_ignore_lower_case(const char *haystack, const char *needle)
 }
 
 /*
- * Multiple used block - searching in string based on configuration
+ * Returns search mode based on configuration and search term
  */
-const char *
-pspg_search(Options *opts, ScrDesc *scrdesc, const char *str)
+SearchMode
+pspg_search_mode(Options *opts, ScrDesc *scrdesc)
 {
 	bool	ignore_case = opts->ignore_case;
 	bool	ignore_lower_case = opts->ignore_lower_case;
-	bool	force8bit = opts->force8bit;
 	bool	has_upperchr = scrdesc->has_upperchr;
-	const char *searchterm = scrdesc->searchterm;
-	const char *result;
 
 	if (ignore_case || (ignore_lower_case && !has_upperchr))
-	{
-		result = force8bit ? nstrstr(str, searchterm) : utf8_nstrstr(str, searchterm);
-	}
+		return SEARCH_IGNORE_CASE;
 	else if (ignore_lower_case && has_upperchr)
-	{
-		result = force8bit ? nstrstr_ignore_lower_case(str, searchterm) : utf8_nstrstr_ignore_lower_case(str, searchterm);
-	}
+		return SEARCH_IGNORE_LOWER_CASE;
 	else
-		result = strstr(str, searchterm);
+		return SEARCH_CASE_SENSITIVE;
+}
+
+/*
+ * Multiple used block - searching in string based on configuration.
+ * The str is a part of row rowstr, the size of found pattern in bytes
+ * is stored to match_size. The rowstr is row lnb_row of lnb.
+ */
+const char *
+pspg_search(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+			LineBuffer *lnb, int lnb_row,
+			const char *rowstr, const char *str, int *match_size)
+{
+	SearchMode	mode = pspg_search_mode(opts, scrdesc);
+
+	if (scrdesc->search_column > 0)
+		return search_in_column(opts, scrdesc, desc, lnb, lnb_row, rowstr, str, match_size);
 
-	return result;
+	if (opts->regex_search)
+		return search_regex(rowstr, str, scrdesc->searchterm,
+							mode == SEARCH_IGNORE_CASE, match_size);
+
+	*match_size = scrdesc->searchterm_size;
+
+	return search_pattern(str, scrdesc->searchterm, mode, opts->force8bit);
 }
 
 /*
  * Translate from UTF8 to semantic characters.
  */
-static bool
+bool
 translate_headline(Options *opts, DataDesc *desc)
 {
 	char   *srcptr;
@@ -739,51 +892,106 @@ translate_headline(Options *opts, DataDesc *desc)
 }
 
 /*
- * Cut text from column and translate it to number.
+ * Returns pointer to text of column "colno" (without leading and trailing
+ * spaces), or NULL when the column is empty. The size of text in bytes is
+ * stored to "size". When the row is first line of multiline value, then
+ * the continuation symbol at end of column is not part of text.
  */
-static bool
-cut_text(char *str, int xmin, int xmax, bool border0, bool force8bit, char **result)
+char *
+get_column_text(Options *opts, DataDesc *desc, char *str, int colno, bool is_continued, int *size)
 {
-#define TEXT_STACK_BUFFER_SIZE		1024
+	char	   *_str = NULL;
+	char	   *after_last_nospc = NULL;
+	bool		border0 = desc->border_type == 0;
+	bool		is_last = colno == desc->columns;
+	int			xmin = desc->cranges[colno - 1].xmin;
+	int			xmax = desc->cranges[colno - 1].xmax;
+	int			mark_pos;
+	int			pos = 0;
+	int			charlen;
+	bool		skip_left_spaces = true;
+
+	if (!str)
+		return NULL;
+
+	/* position of continuation symbol, when the column has borders */
+	mark_pos = desc->headline_transl && desc->headline_transl[xmax] == 'd' ? xmax : xmax - 1;
+
+	/* fast skip of chars with display width 1 before column */
+	while (pos < xmin && *str &&
+		   (opts->force8bit || ((unsigned char) *str >= 0x20 && (unsigned char) *str < 0x7f)))
+	{
+		pos += 1;
+		str += 1;
+	}
 
-	if (str)
+	while (*str)
 	{
-		char	   *_str = NULL;
-		char	   *after_last_nospc = NULL;
-		int			pos = 0;
-		int			charlen;
-		bool		skip_left_spaces = true;
+		charlen = opts->force8bit ? 1 : utf8charlen(*str);
 
-		while (*str)
+		if (is_continued && is_line_continuation_char(str, desc))
 		{
-			charlen = utf8charlen(*str);
+			/* without border, the symbol is on separator before column */
+			if (border0 && colno > 1 && pos == xmin)
+			{
+				pos += 1;
+				str += charlen;
+				continue;
+			}
+			else if (!border0 && pos == mark_pos)
+				break;
+		}
 
-			if (pos > xmin || (border0 && pos >= xmin))
+		if (pos > xmin || (border0 && pos >= xmin))
+		{
+			if (skip_left_spaces)
 			{
-				if (skip_left_spaces)
+				if (*str == ' ')
 				{
-					if (*str == ' ')
-					{
-						pos += 1;
-						str += 1;
-						continue;
-					}
-
-					/* first nspc char */
-					skip_left_spaces = false;
-					_str = str;
+					pos += 1;
+					str += 1;
+					continue;
 				}
+
+				/* first nspc char */
+				skip_left_spaces = false;
+				_str = str;
 			}
+		}
 
-			if (*str != ' ')
-				after_last_nospc = str + charlen;
+		if (*str != ' ')
+			after_last_nospc = str + charlen;
 
-			pos += utf_dsplen(str);
-			str += charlen;
+		pos += opts->force8bit ? 1 : utf_dsplen(str);
+		str += charlen;
 
-			if (pos >= xmax)
-				break;
-		}
+		/*
+		 * The xmax is position of separator of columns (or of border), but
+		 * without border, the xmax of last column is position of its last
+		 * char.
+		 */
+		if (pos > xmax || (pos == xmax && !(border0 && is_last)))
+			break;
+	}
+
+	if (_str != NULL)
+		*size = after_last_nospc - _str;
+
+	return _str;
+}
+
+/*
+ * Cut text from column and translate it to number.
+ */
+static bool
+cut_text(Options *opts, DataDesc *desc, char *str, int colno, bool is_continued, char **result)
+{
+#define TEXT_STACK_BUFFER_SIZE		1024
+
+	if (str)
+	{
+		int			text_size;
+		char	   *_str = get_column_text(opts, desc, str, colno, is_continued, &text_size);
 
 		if (_str != NULL)
 		{
@@ -793,11 +1001,11 @@ cut_text(char *str, int xmin, int xmax, bool border0, bool force8bit, char **res
 			int			size;
 			int			dynbuf_size = 0;
 
-			cstr = strndup(_str, after_last_nospc - _str);
+			cstr = strndup(_str, text_size);
 			if (!cstr)
 				leave_ncurses("out of memory");
 
-			if (force8bit)
+			if (opts->force8bit)
 			{
 				*result = cstr;
 				return true;
@@ -1055,7 +1263,7 @@ cut_numeric_value(char *str, int xmin, int xmax, double *d, bool border0, bool *
 /*
  * Trim footer rows - We should to trim footer rows and calculate footer_char_size
  */
-static void
+void
 trim_footer_rows(Options *opts, DataDesc *desc)
 {
 	if (desc->headline_transl != NULL && desc->footer_row != -1)
@@ -1323,7 +1531,7 @@ strncpytrim(Options *opts, char *dest, const char *src,
 /*
  * Read data from file and fill DataDesc.
  */
-static int
+int
 readfile(FILE *fp, Options *opts, DataDesc *desc)
 {
 	char	   *line = NULL;
@@ -1365,6 +1573,26 @@ readfile(FILE *fp, Options *opts, DataDesc *desc)
 	desc->is_pgcli_fmt = false;
 	desc->namesline = NULL;
 	desc->order_map = NULL;
+	desc->sort_cache = NULL;
+	desc->search_index = NULL;
+	desc->hidden_records = NULL;
+	desc->nvisible_records = 0;
+	desc->hidden_rows = 0;
+	desc->bookmarks = NULL;
+	desc->nbookmarks = 0;
+	desc->bookmarks_size = 0;
+	desc->bookmark_positions = NULL;
+	desc->nbookmark_positions = 0;
+	desc->bookmark_positions_valid = false;
+	desc->bookmarks_changed = false;
+	desc->bookmarks_file_size = 0;
+	desc->bookmarks_file_mtime = 0;
+	desc->column_data = NULL;
+	desc->records = NULL;
+	desc->nrecords = 0;
+	desc->nsort_keys = 0;
+	desc->order_map_is_partial = false;
+	desc->order_map_sorted_records = 0;
 	desc->total_rows = 0;
 
 	desc->maxbytes = -1;
@@ -1375,6 +1603,7 @@ readfile(FILE *fp, Options *opts, DataDesc *desc)
 	desc->rows.prev = NULL;
 	desc->oid_name_table = false;
 	desc->multilines_already_tested = false;
+	desc->has_multilines = false;
 
 	errno = 0;
 
@@ -1399,13 +1628,17 @@ readfile(FILE *fp, Options *opts, DataDesc *desc)
 				exit(EXIT_FAILURE);
 			}
 
+			mem_alloc(MEM_LINEBUFFERS, sizeof(LineBuffer));
+
 			memset(newrows, 0, sizeof(LineBuffer));
+			newrows->first_row = rows->first_row + rows->nrows;
 			rows->next = newrows;
 			newrows->prev = rows;
 			rows = newrows;
 		}
 
 		rows->rows[rows->nrows++] = line;
+		mem_alloc(MEM_ROWS, read + 1);
 
 		/* save possible table name */
 		if (nrows == 0 && !isTopLeftChar(line))
@@ -1527,167 +1760,164 @@ readfile(FILE *fp, Options *opts, DataDesc *desc)
 }
 
 /*
- * Prepare order map - it is used for printing data in different than
- * original order. "sbcn" - sort by column number
+ * Detect rows with continuation symbol (multiline values). It is
+ * done only once, because data are immutable. It should be called
+ * after translate_headline.
+ *
+ * The continuation symbol can be only on few positions (on borders
+ * of columns). These positions are calculated from translated headline
+ * first, and then only these positions are checked. Rows without any
+ * char of continuation symbol are skipped by fast test.
  */
-static void
-update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool desc_sort)
+void
+detect_multilines(Options *opts, DataDesc *desc)
 {
 	LineBuffer	   *lnb = &desc->rows;
-	char		   *nullstr = NULL;
-	int				xmin, xmax;
+	int			   *positions;
+	int				npositions = 0;
 	int				lineno = 0;
-	bool			continual_line = false;
-	bool			has_multilines = false;
-	bool			isnull;
-	bool			detect_string_column = false;
-	bool			border0 = (desc->border_type == 0);
-	bool			border1 = (desc->border_type == 1);
-	bool			border2 = (desc->border_type == 2);
-	SortData	   *sortbuf;
-	int				sortbuf_pos = 0;
 	int			i;
 
-	xmin = desc->cranges[sbcn - 1].xmin;
-	xmax = desc->cranges[sbcn - 1].xmax;
+	if (desc->multilines_already_tested)
+		return;
 
-	sortbuf = malloc(desc->total_rows * sizeof(SortData));
-	if (!sortbuf)
+	desc->multilines_already_tested = true;
+
+	if (!desc->headline_transl || desc->is_expanded_mode || desc->first_data_row < 0)
+		return;
+
+	positions = malloc((desc->headline_char_size + 2) * sizeof(int));
+	if (!positions)
 		leave_ncurses("out of memory");
 
-	/* first time we should to detect multilines */
-	if (!desc->multilines_already_tested)
+	for (i = 0; i < desc->headline_char_size; i++)
 	{
-		desc->multilines_already_tested = true;
+		char	next = i + 1 < desc->headline_char_size ? desc->headline_transl[i + 1] : '\0';
 
-		lnb = &desc->rows;
-		lineno = 0;
+		if (desc->border_type == 0)
+		{
+			if (desc->headline_transl[i] == 'I')
+				positions[npositions++] = i;
+			else if (i + 1 == desc->headline_char_size)
+			{
+				/* border 0, last continuation symbol is after headline */
+				positions[npositions++] = i + 1;
+			}
+		}
+		else if (desc->border_type == 1)
+		{
+			if (next == 'I' || i + 1 == desc->headline_char_size)
+				positions[npositions++] = i;
+		}
+		else if (desc->border_type == 2)
+		{
+			if (next == 'I' || next == 'R')
+				positions[npositions++] = i;
+		}
+	}
 
-		while (lnb)
+	while (lnb && npositions > 0)
+	{
+		for (i = 0; i < lnb->nrows; i++)
 		{
-			for (i = 0; i < lnb->nrows; i++)
+			if (lineno >= desc->first_data_row && lineno <= desc->last_data_row)
 			{
-				if (lineno >= desc->first_data_row && lineno <= desc->last_data_row)
+				char   *str = lnb->rows[i];
+				bool	found_continuation_symbol = false;
+
+				/* fast test, row without these chars cannot be multiline */
+				if (desc->linestyle == 'a' ?
+						strpbrk(str, "+.") != NULL :
+						(strstr(str, "\342\206\265") != NULL || strstr(str, "\342\200\246") != NULL))
 				{
-					char   *str = lnb->rows[i];
-					bool	found_continuation_symbol = false;
 					int		j = 0;
+					int		k;
 
-					while (j < desc->headline_char_size)
+					for (k = 0; k < npositions && *str; k++)
 					{
-						if (border0)
+						while (j < positions[k] && *str)
 						{
-							/* border 0, last continuation symbol is after headline */
-							if (j + 1 == desc->headline_char_size)
-							{
-								char	*sym;
-
-								sym = str + (opts->force8bit ? 1 : utf8charlen(*str));
-								if (*sym != '\0')
-									found_continuation_symbol = is_line_continuation_char(sym, desc);
-							}
-							else if (desc->headline_transl[j] == 'I')
-								found_continuation_symbol = is_line_continuation_char(str, desc);
-						}
-						else if (border1)
-						{
-							if ((j + 1 < desc->headline_char_size && desc->headline_transl[j + 1] == 'I') ||
-									  (j + 1 == desc->headline_char_size))
-								found_continuation_symbol = is_line_continuation_char(str, desc);
-						}
-						else if (border2)
-						{
-							if ((j + 1 < desc->headline_char_size) &&
-									(desc->headline_transl[j + 1] == 'I' || desc->headline_transl[j + 1] == 'R'))
-								found_continuation_symbol = is_line_continuation_char(str, desc);
+							j += opts->force8bit ? 1 : utf_dsplen(str);
+							str += opts->force8bit ? 1 : utf8charlen(*str);
 						}
 
-						if (found_continuation_symbol)
+						if (j == positions[k] && *str &&
+							is_line_continuation_char(str, desc))
+						{
+							found_continuation_symbol = true;
 							break;
-
-						j += opts->force8bit ? 1 : utf_dsplen(str);
-						str += opts->force8bit ? 1 : utf8charlen(*str);
+						}
 					}
+				}
 
-					if (found_continuation_symbol)
+				if (found_continuation_symbol)
+				{
+					if (lnb->continuations == NULL)
 					{
-						if (lnb->lineinfo == NULL)
-						{
-							lnb->lineinfo = malloc(1000 * sizeof(LineInfo));
-							if (lnb->lineinfo == NULL)
-								leave_ncurses("out of memory");
+						lnb->continuations = malloc(LINEINFO_BITMAP_SIZE);
+						if (lnb->continuations == NULL)
+							leave_ncurses("out of memory");
 
-							memset(lnb->lineinfo, 0, 1000 * sizeof(LineInfo));
-						}
+						mem_alloc(MEM_LINEINFO, LINEINFO_BITMAP_SIZE);
 
-						lnb->lineinfo[i].mask ^= LINEINFO_CONTINUATION;
-						has_multilines = true;
+						memset(lnb->continuations, 0, LINEINFO_BITMAP_SIZE);
 					}
-				}
 
-				lineno += 1;
+					LINEINFO_SET(lnb->continuations, i);
+					desc->has_multilines = true;
+				}
 			}
-			lnb = lnb->next;
+
+			lineno += 1;
 		}
+		lnb = lnb->next;
 	}
 
-	lnb = &desc->rows;
-	lineno = 0;
-	sortbuf_pos = 0;
+	free(positions);
+}
 
-	if (!desc->order_map)
-	{
-		desc->order_map = malloc(desc->total_rows * sizeof(MappedLine));
-		if (!desc->order_map)
-			leave_ncurses("out of memory");
-	}
+/*
+ * Prepare array of records - data rows without continuation rows of
+ * multiline values. The index to this array is used as index of values
+ * in column data and sort caches.
+ */
+void
+prepare_records(Options *opts, DataDesc *desc)
+{
+	LineBuffer	   *lnb = &desc->rows;
+	int				lineno = 0;
+	bool			continual_line = false;
+	int			i;
+
+	detect_multilines(opts, desc);
+
+	if (desc->records)
+		return;
+
+	desc->records = malloc((desc->total_rows + 1) * sizeof(MappedLine));
+	if (!desc->records)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_RECORDS, (desc->total_rows + 1) * sizeof(MappedLine));
+
+	desc->nrecords = 0;
 
-	/*
-	 * There are two possible sorting methods: numeric or string.
-	 * We can try numeric sort first if all values are numbers or
-	 * just only one type of string value (like NULL string). This
-	 * value can be repeated,
-	 *
-	 * When there are more different strings, then start again and
-	 * use string sort.
-	 */
 	while (lnb)
 	{
 		for (i = 0; i < lnb->nrows; i++)
 		{
-			desc->order_map[lineno].lnb = lnb;
-			desc->order_map[lineno].lnb_row = i;
-
 			if (lineno >= desc->first_data_row && lineno <= desc->last_data_row)
 			{
 				if (!continual_line)
 				{
-					sortbuf[sortbuf_pos].lnb = lnb;
-					sortbuf[sortbuf_pos].lnb_row = i;
-					sortbuf[sortbuf_pos].strxfrm = NULL;
-
-					if (cut_numeric_value(lnb->rows[i],
-										   xmin, xmax,
-										   &sortbuf[sortbuf_pos].d,
-										   border0,
-										   &isnull,
-										   &nullstr))
-						sortbuf[sortbuf_pos++].info = INFO_DOUBLE;
-					else
-					{
-						sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;
-						if (!isnull)
-						{
-							detect_string_column = true;
-							goto sort_by_string;
-						}
-					}
+					desc->records[desc->nrecords].lnb = lnb;
+					desc->records[desc->nrecords++].lnb_row = i;
 				}
 
-				if (has_multilines)
+				if (desc->has_multilines)
 				{
-					continual_line = (lnb->lineinfo &&
-									  (lnb->lineinfo[i].mask & LINEINFO_CONTINUATION));
+					continual_line = (lnb->continuations &&
+									  LINEINFO_IS_SET(lnb->continuations, i));
 				}
 			}
 
@@ -1697,80 +1927,557 @@ update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int sbcn, bool
 		lnb = lnb->next;
 	}
 
-sort_by_string:
+	if (lineno != desc->total_rows)
+		leave_ncurses("unexpected processed rows after records prepare");
+}
 
-	free(nullstr);
+/*
+ * Returns typed values of column "colno". Values are extracted from
+ * formatted rows only once, then they are reused until data are changed.
+ */
+ColumnData *
+get_column_data(Options *opts, DataDesc *desc, int colno)
+{
+	ColumnData	   *cd;
+	char		   *nullstr = NULL;
+	int				xmin, xmax;
+	bool			isnull;
+	bool			border0 = (desc->border_type == 0);
+	int				nulls_size;
+	int			i;
+
+	prepare_records(opts, desc);
 
-	if (detect_string_column)
+	if (!desc->column_data)
 	{
-		/* read data again and use nls_string */
-		lnb = &desc->rows;
-		lineno = 0;
-		sortbuf_pos = 0;
-		while (lnb)
-		{
-			for (i = 0; i < lnb->nrows; i++)
-			{
-				desc->order_map[lineno].lnb = lnb;
-				desc->order_map[lineno].lnb_row = i;
+		desc->column_data = malloc(desc->columns * sizeof(ColumnData));
+		if (!desc->column_data)
+			leave_ncurses("out of memory");
 
-				if (lineno >= desc->first_data_row && lineno <= desc->last_data_row)
-				{
-					if (!continual_line)
-					{
-						sortbuf[sortbuf_pos].lnb = lnb;
-						sortbuf[sortbuf_pos].lnb_row = i;
-						sortbuf[sortbuf_pos].d = 0.0;
+		memset(desc->column_data, 0, desc->columns * sizeof(ColumnData));
+		mem_alloc(MEM_COLUMN_DATA, desc->columns * sizeof(ColumnData));
+	}
 
-						if (cut_text(lnb->rows[i], xmin, xmax, border0, opts->force8bit, &sortbuf[sortbuf_pos].strxfrm))
-							sortbuf[sortbuf_pos++].info = INFO_STRXFRM;
-						else
-							sortbuf[sortbuf_pos++].info = INFO_UNKNOWN;		/* empty string */
-					}
+	cd = &desc->column_data[colno - 1];
+	if (cd->nulls)
+		return cd;
 
-					if (has_multilines)
-					{
-						continual_line =  (lnb->lineinfo &&
-										   (lnb->lineinfo[i].mask & LINEINFO_CONTINUATION));
-					}
-				}
+	xmin = desc->cranges[colno - 1].xmin;
+	xmax = desc->cranges[colno - 1].xmax;
 
-				lineno += 1;
-			}
-			lnb = lnb->next;
-		}
-	}
+	nulls_size = (desc->nrecords >> 3) + 1;
 
-	if (lineno != desc->total_rows)
-		leave_ncurses("unexpected processed rows after sort prepare");
+	cd->nulls = malloc(nulls_size);
+	cd->values = malloc((desc->nrecords + 1) * sizeof(double));
+	if (!cd->nulls || !cd->values)
+		leave_ncurses("out of memory");
 
-	if (detect_string_column)
-		sort_column_text(sortbuf, sortbuf_pos, desc_sort);
-	else
-		sort_column_num(sortbuf, sortbuf_pos, desc_sort);
+	mem_alloc(MEM_COLUMN_DATA, nulls_size);
+	mem_alloc(MEM_COLUMN_DATA, (desc->nrecords + 1) * sizeof(double));
 
-	lineno = desc->first_data_row;
+	memset(cd->nulls, 0, nulls_size);
 
-	for (i = 0; i < sortbuf_pos; i++)
+	/*
+	 * There are two possible types of values: numeric or string.
+	 * We can try numeric type first if all values are numbers or
+	 * just only one type of string value (like NULL string). This
+	 * value can be repeated,
+	 *
+	 * When there are more different strings, then start again and
+	 * use string type.
+	 */
+	for (i = 0; i < desc->nrecords; i++)
 	{
-		desc->order_map[lineno].lnb = sortbuf[i].lnb;
-		desc->order_map[lineno].lnb_row = sortbuf[i].lnb_row;
-		lineno += 1;
-
-		/* assign other continual lines */
-		if (has_multilines)
+		MappedLine *dr = &desc->records[i];
+
+		if (!cut_numeric_value(dr->lnb->rows[dr->lnb_row],
+							   xmin, xmax,
+							   &cd->values[i],
+							   border0,
+							   &isnull,
+							   &nullstr))
 		{
-			int		lnb_row;
-			bool	continual = false;
+			cd->values[i] = 0.0;
+			COLUMN_DATA_SET_NULL(cd, i);
 
-			lnb = sortbuf[i].lnb;
-			lnb_row = sortbuf[i].lnb_row;
+			if (!isnull)
+			{
+				cd->is_string = true;
+				break;
+			}
+		}
+	}
 
-			continual = lnb->lineinfo &&
-									   (lnb->lineinfo[lnb_row].mask & LINEINFO_CONTINUATION);
+	free(nullstr);
 
-			while (lnb && continual)
-			{
+	if (cd->is_string)
+	{
+		/* read data again and use nls_string */
+		memset(cd->nulls, 0, nulls_size);
+
+		cd->strxfrm = malloc((desc->nrecords + 1) * sizeof(char *));
+		if (!cd->strxfrm)
+			leave_ncurses("out of memory");
+
+		mem_alloc(MEM_COLUMN_DATA, (desc->nrecords + 1) * sizeof(char *));
+
+		for (i = 0; i < desc->nrecords; i++)
+		{
+			MappedLine *dr = &desc->records[i];
+
+			cd->values[i] = 0.0;
+
+			if (!cut_text(opts, desc, dr->lnb->rows[dr->lnb_row], colno,
+						  RECORD_IS_CONTINUED(desc, dr), &cd->strxfrm[i]))
+			{
+				/* empty string */
+				cd->strxfrm[i] = NULL;
+				COLUMN_DATA_SET_NULL(cd, i);
+			}
+			else
+				mem_alloc(MEM_COLUMN_DATA, strlen(cd->strxfrm[i]) + 1);
+		}
+	}
+
+	return cd;
+}
+
+/*
+ * Releases all cached column data. Should be called when data are changed.
+ */
+static void
+free_column_data(DataDesc *desc)
+{
+	int		i, j;
+
+	if (desc->column_data)
+	{
+		for (i = 0; i < desc->columns; i++)
+		{
+			ColumnData *cd = &desc->column_data[i];
+
+			if (cd->strxfrm)
+			{
+				for (j = 0; j < desc->nrecords; j++)
+				{
+					if (cd->strxfrm[j])
+					{
+						mem_free(MEM_COLUMN_DATA, strlen(cd->strxfrm[j]) + 1);
+						free(cd->strxfrm[j]);
+					}
+				}
+
+				mem_free(MEM_COLUMN_DATA, (desc->nrecords + 1) * sizeof(char *));
+				free(cd->strxfrm);
+			}
+
+			if (cd->nulls)
+			{
+				mem_free(MEM_COLUMN_DATA, (desc->nrecords >> 3) + 1);
+				mem_free(MEM_COLUMN_DATA, (desc->nrecords + 1) * sizeof(double));
+			}
+
+			free(cd->values);
+			free(cd->nulls);
+		}
+
+		mem_free(MEM_COLUMN_DATA, desc->columns * sizeof(ColumnData));
+		free(desc->column_data);
+		desc->column_data = NULL;
+	}
+
+	if (desc->records)
+	{
+		mem_free(MEM_RECORDS, (desc->total_rows + 1) * sizeof(MappedLine));
+		free(desc->records);
+	}
+
+	desc->records = NULL;
+	desc->nrecords = 0;
+}
+
+/*
+ * Returns cache entry of column "sbcn" with values prepared for sort.
+ * The values are not sorted, when the ranks are not calculated yet.
+ */
+static SortCache *
+extract_sort_data(Options *opts, DataDesc *desc, int sbcn)
+{
+	SortCache	   *sc;
+	ColumnData	   *cd;
+	SortData	   *sortbuf;
+	int			i;
+
+	if (!desc->sort_cache)
+	{
+		desc->sort_cache = malloc(desc->columns * sizeof(SortCache));
+		if (!desc->sort_cache)
+			leave_ncurses("out of memory");
+
+		memset(desc->sort_cache, 0, desc->columns * sizeof(SortCache));
+		mem_alloc(MEM_SORT, desc->columns * sizeof(SortCache));
+	}
+
+	sc = &desc->sort_cache[sbcn - 1];
+	if (sc->sortbuf)
+		return sc;
+
+	cd = get_column_data(opts, desc, sbcn);
+
+	sortbuf = malloc((desc->nrecords + 1) * sizeof(SortData));
+	if (!sortbuf)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SORT, (desc->nrecords + 1) * sizeof(SortData));
+
+	for (i = 0; i < desc->nrecords; i++)
+	{
+		sortbuf[i].lnb = desc->records[i].lnb;
+		sortbuf[i].lnb_row = desc->records[i].lnb_row;
+		sortbuf[i].seqno = i;
+		sortbuf[i].d = cd->values[i];
+
+		/* strings are owned by column data */
+		sortbuf[i].strxfrm = cd->strxfrm ? cd->strxfrm[i] : NULL;
+
+		if (COLUMN_DATA_IS_NULL(cd, i))
+			sortbuf[i].info = INFO_UNKNOWN;
+		else
+			sortbuf[i].info = cd->is_string ? INFO_STRXFRM : INFO_DOUBLE;
+	}
+
+	sc->sortbuf = sortbuf;
+	sc->nitems = desc->nrecords;
+	sc->is_string = cd->is_string;
+
+	return sc;
+}
+
+/*
+ * Returns sorted data of column "sbcn". Values are sorted only once.
+ */
+static SortCache *
+get_sort_cache(Options *opts, DataDesc *desc, int sbcn)
+{
+	SortCache	   *sc;
+	SortData	   *sortbuf;
+	int			i;
+
+	sc = extract_sort_data(opts, desc, sbcn);
+	if (sc->ranks)
+		return sc;
+
+	sortbuf = sc->sortbuf;
+
+	if (sc->is_string)
+		sort_column_text(sortbuf, sc->nitems, false);
+	else
+		sort_column_num(sortbuf, sc->nitems, false);
+
+	/* rows with unknown value are sorted to end */
+	sc->nvalid = sc->nitems;
+	while (sc->nvalid > 0 && sortbuf[sc->nvalid - 1].info == INFO_UNKNOWN)
+		sc->nvalid -= 1;
+
+	/* same values has same rank, it is used for sort by more columns */
+	sc->ranks = malloc((sc->nitems + 1) * sizeof(int));
+	if (!sc->ranks)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SORT, (sc->nitems + 1) * sizeof(int));
+
+	for (i = 0; i < sc->nitems; i++)
+	{
+		int		rank;
+
+		if (i >= sc->nvalid)
+			rank = -1;
+		else if (i == 0)
+			rank = 0;
+		else if (sc->is_string ?
+					strcmp(sortbuf[i].strxfrm, sortbuf[i - 1].strxfrm) != 0 :
+					sortbuf[i].d != sortbuf[i - 1].d)
+			rank = sc->ranks[sortbuf[i - 1].seqno] + 1;
+		else
+			rank = sc->ranks[sortbuf[i - 1].seqno];
+
+		sc->ranks[sortbuf[i].seqno] = rank;
+	}
+
+	return sc;
+}
+
+/*
+ * Releases all cached sorted data. Should be called when data are changed.
+ */
+static void
+free_sort_cache(DataDesc *desc)
+{
+	int		i;
+
+	if (!desc->sort_cache)
+		return;
+
+	for (i = 0; i < desc->columns; i++)
+	{
+		SortCache  *sc = &desc->sort_cache[i];
+
+		if (sc->sortbuf)
+			mem_free(MEM_SORT, (sc->nitems + 1) * sizeof(SortData));
+		if (sc->ranks)
+			mem_free(MEM_SORT, (sc->nitems + 1) * sizeof(int));
+
+		free(sc->sortbuf);
+		free(sc->ranks);
+	}
+
+	mem_free(MEM_SORT, desc->columns * sizeof(SortCache));
+	free(desc->sort_cache);
+	desc->sort_cache = NULL;
+}
+
+/*
+ * Rows after data rows (bottom border, footer) are moved, when the number
+ * of displayed data rows is changed.
+ */
+static void
+shift_rows_after_data(DataDesc *desc, int offset)
+{
+	if (desc->border_bottom_row > desc->last_data_row)
+		desc->border_bottom_row += offset;
+	if (desc->footer_row > desc->last_data_row)
+		desc->footer_row += offset;
+	if (desc->alt_footer_row > desc->last_data_row)
+		desc->alt_footer_row += offset;
+
+	desc->last_data_row += offset;
+	desc->last_row += offset;
+	desc->maxy += offset;
+}
+
+/*
+ * Prepare order map - it is used for printing data in different than
+ * original order. Data are sorted by "nkeys" sort keys, first key is
+ * most significant. Without keys, the original order is used. Records
+ * hidden by filter are not in order map.
+ *
+ * When "limit" is positive, then only first "limit" rows should be in
+ * final order (for fast displaying of first screen). In this case the
+ * order map can be partial, and it should be completed later by calling
+ * this function with zero limit.
+ */
+void
+update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, SortKey *keys, int nkeys, int limit)
+{
+	LineBuffer	   *lnb = &desc->rows;
+	SortCache	   *sc = NULL;
+	int			   *rownums;
+	int				lineno = 0;
+	int				nitems;
+	int				last_data_row;
+	int				hidden_rows;
+	long			trace_start;
+	int			i;
+
+	/* bookmarks will be on different positions */
+	invalidate_bookmark_positions(desc);
+
+	if (nkeys == 0 && !desc->hidden_records)
+	{
+		/* all rows in original order, order map is not necessary */
+		if (desc->hidden_rows > 0)
+		{
+			shift_rows_after_data(desc, desc->hidden_rows);
+			desc->hidden_rows = 0;
+		}
+
+		if (desc->order_map)
+		{
+			mem_free(MEM_RECORDS, desc->total_rows * sizeof(MappedLine));
+			free(desc->order_map);
+		}
+
+		desc->order_map = NULL;
+		desc->order_map_is_partial = false;
+		desc->nsort_keys = 0;
+
+		free_search_index(desc);
+		scrdesc->found_row = -1;
+
+		return;
+	}
+
+	trace_start = trace_begin();
+
+	prepare_records(opts, desc);
+
+	nitems = desc->nrecords;
+
+	rownums = malloc((nitems + 1) * sizeof(int));
+	if (!rownums)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SORT, (nitems + 1) * sizeof(int));
+
+	desc->order_map_is_partial = false;
+
+	/* partial sort is not used, when some records can be hidden */
+	if (nkeys == 1 && !desc->hidden_records &&
+		!extract_sort_data(opts, desc, keys[0].column)->ranks &&
+		limit > 0 && limit < nitems / 2)
+	{
+		bool   *selected;
+		int		pos;
+
+		sc = extract_sort_data(opts, desc, keys[0].column);
+
+		/*
+		 * Column is not sorted yet, but we need only first rows. These rows
+		 * can be selected without full sort. Other rows are in original
+		 * order until full sort will be done.
+		 */
+		pos = select_top_rows(sc->sortbuf, sc->nitems, limit, sc->is_string, keys[0].desc, rownums);
+		desc->order_map_sorted_records = pos;
+
+		selected = malloc((sc->nitems + 1) * sizeof(bool));
+		if (!selected)
+			leave_ncurses("out of memory");
+
+		mem_alloc(MEM_SORT, (sc->nitems + 1) * sizeof(bool));
+
+		memset(selected, 0, sc->nitems * sizeof(bool));
+
+		for (i = 0; i < pos; i++)
+			selected[rownums[i]] = true;
+
+		for (i = 0; i < sc->nitems; i++)
+		{
+			if (!selected[i])
+				rownums[pos++] = i;
+		}
+
+		mem_free(MEM_SORT, (sc->nitems + 1) * sizeof(bool));
+		free(selected);
+
+		desc->order_map_is_partial = true;
+	}
+	else if (nkeys == 0)
+	{
+		for (i = 0; i < nitems; i++)
+			rownums[i] = i;
+	}
+	else if (nkeys == 1 && !keys[0].desc)
+	{
+		sc = get_sort_cache(opts, desc, keys[0].column);
+
+		for (i = 0; i < nitems; i++)
+			rownums[i] = sc->sortbuf[i].seqno;
+	}
+	else if (nkeys == 1)
+	{
+		int		pos = 0;
+		int		group_end;
+
+		sc = get_sort_cache(opts, desc, keys[0].column);
+		group_end = sc->nvalid;
+
+		/*
+		 * Descending order is ascending order of known values read in
+		 * reverse order. The groups of same values holds original order.
+		 * Rows with unknown values are at end every time.
+		 */
+		while (group_end > 0)
+		{
+			int		group_start = group_end - 1;
+			int		rank = sc->ranks[sc->sortbuf[group_start].seqno];
+
+			while (group_start > 0 && sc->ranks[sc->sortbuf[group_start - 1].seqno] == rank)
+				group_start -= 1;
+
+			for (i = group_start; i < group_end; i++)
+				rownums[pos++] = sc->sortbuf[i].seqno;
+
+			group_end = group_start;
+		}
+
+		for (i = sc->nvalid; i < sc->nitems; i++)
+			rownums[pos++] = sc->sortbuf[i].seqno;
+	}
+	else
+	{
+		int	   *ranks[MAX_SORT_KEYS];
+		bool	descs[MAX_SORT_KEYS];
+
+		for (i = 0; i < nkeys; i++)
+		{
+			ranks[i] = get_sort_cache(opts, desc, keys[i].column)->ranks;
+			descs[i] = keys[i].desc;
+		}
+
+		for (i = 0; i < nitems; i++)
+			rownums[i] = i;
+
+		sort_rows_by_ranks(rownums, nitems, ranks, descs, nkeys);
+	}
+
+	if (nkeys > 0)
+		memcpy(desc->sort_keys, keys, nkeys * sizeof(SortKey));
+	desc->nsort_keys = nkeys;
+
+	/* positions of found patterns are changed */
+	free_search_index(desc);
+
+	if (!desc->order_map)
+	{
+		desc->order_map = malloc(desc->total_rows * sizeof(MappedLine));
+		if (!desc->order_map)
+			leave_ncurses("out of memory");
+
+		mem_alloc(MEM_RECORDS, desc->total_rows * sizeof(MappedLine));
+	}
+
+	/* rows outside data part holds their positions */
+	while (lnb)
+	{
+		for (i = 0; i < lnb->nrows; i++)
+		{
+			desc->order_map[lineno].lnb = lnb;
+			desc->order_map[lineno].lnb_row = i;
+			lineno += 1;
+		}
+		lnb = lnb->next;
+	}
+
+	/* position of last data row, when all rows are displayed */
+	last_data_row = desc->last_data_row + desc->hidden_rows;
+
+	lineno = desc->first_data_row;
+
+	for (i = 0; i < nitems; i++)
+	{
+		MappedLine *dr = &desc->records[rownums[i]];
+
+		if (desc->hidden_records && RECORD_IS_HIDDEN(desc, rownums[i]))
+			continue;
+
+		desc->order_map[lineno].lnb = dr->lnb;
+		desc->order_map[lineno].lnb_row = dr->lnb_row;
+		lineno += 1;
+
+		/* assign other continual lines */
+		if (desc->has_multilines)
+		{
+			int		lnb_row;
+			bool	continual = false;
+
+			lnb = dr->lnb;
+			lnb_row = dr->lnb_row;
+
+			continual = lnb->continuations &&
+									   LINEINFO_IS_SET(lnb->continuations, lnb_row);
+
+			while (lnb && continual)
+			{
 				lnb_row += 1;
 				if (lnb_row >= lnb->nrows)
 				{
@@ -1782,22 +2489,35 @@ sort_by_string:
 				desc->order_map[lineno].lnb_row = lnb_row;
 				lineno += 1;
 
-				continual = lnb && lnb->lineinfo &&
-								(lnb->lineinfo[lnb_row].mask & LINEINFO_CONTINUATION);
+				continual = lnb && lnb->continuations &&
+								LINEINFO_IS_SET(lnb->continuations, lnb_row);
 			}
 		}
 	}
 
+	/* rows after data are moved to end of displayed data rows */
+	hidden_rows = last_data_row + 1 - lineno;
+	if (hidden_rows > 0)
+		memmove(&desc->order_map[lineno],
+				&desc->order_map[last_data_row + 1],
+				(desc->total_rows - last_data_row - 1) * sizeof(MappedLine));
+
+	if (hidden_rows != desc->hidden_rows)
+	{
+		shift_rows_after_data(desc, desc->hidden_rows - hidden_rows);
+		desc->hidden_rows = hidden_rows;
+	}
+
 	/*
 	 * We cannot to say nothing about found_row, so most
 	 * correct solution is clean it now.
 	 */
 	scrdesc->found_row = -1;
 
-	for (i = 0; i < sortbuf_pos; i++)
-		free(sortbuf[i].strxfrm);
+	mem_free(MEM_SORT, (nitems + 1) * sizeof(int));
+	free(rownums);
 
-	free(sortbuf);
+	trace_end("sort", limit > 0 ? "partial sort" : "sort", trace_start, "rows", nitems);
 }
 
 /*
@@ -2009,6 +2729,131 @@ create_layout(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int first_data_ro
 								   scrdesc->fix_rows_rows + scrdesc->main_start_y,
 								   0);
 	}
+
+	/* new windows are empty, so they should be filled fully */
+	memset(scrdesc->fill_state, 0, sizeof(scrdesc->fill_state));
+}
+
+/*
+ * Draws memory usage overlay to right top corner of data area. The window
+ * is released, when the overlay is disabled or the screen is too small.
+ */
+static void
+refresh_memstats_overlay(Options *opts, ScrDesc *scrdesc, WINDOW **win)
+{
+	int		rows, cols;
+	int		maxy, maxx;
+
+	memstats_overlay_size(&rows, &cols);
+	getmaxyx(stdscr, maxy, maxx);
+
+	if (!opts->show_memstats ||
+		scrdesc->top_bar_rows + rows >= maxy || cols + 1 >= maxx)
+	{
+		if (*win)
+		{
+			delwin(*win);
+			*win = NULL;
+		}
+
+		return;
+	}
+
+	if (!*win)
+	{
+		*win = newwin(rows, cols, scrdesc->top_bar_rows, maxx - cols - 1);
+		if (!*win)
+			leave_ncurses("cannot to create window");
+	}
+	else
+		mvwin(*win, scrdesc->top_bar_rows, maxx - cols - 1);
+
+	memstats_draw(*win,
+				  scrdesc->themes[WINDOW_ROWS].cursor_data_attr,
+				  scrdesc->themes[WINDOW_ROWS].cursor_line_attr);
+}
+
+/*
+ * Fill all windows with data and prepare them for refresh. The vertical
+ * cursor is not drawn, when its positions are -1.
+ */
+static void
+draw_data_windows(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				  int first_data_row, int first_row, int fix_rows_offset,
+				  int cursor_row, int cursor_col, int footer_cursor_col,
+				  int vcursor_xmin_fix, int vcursor_xmax_fix,
+				  int vcursor_xmin_data, int vcursor_xmax_data)
+{
+	profile_begin(PROFILE_WINDOW_FILL);
+
+	window_fill(WINDOW_LUC,
+				desc->title_rows + desc->fixed_rows - scrdesc->fix_rows_rows,
+				0,
+				-1,
+				vcursor_xmin_fix, vcursor_xmax_fix,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_ROWS,
+				first_data_row + first_row - fix_rows_offset,
+				scrdesc->fix_cols_cols + cursor_col,
+				cursor_row - first_row + fix_rows_offset,
+				vcursor_xmin_data, vcursor_xmax_data,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_FIX_COLS,
+				first_data_row + first_row - fix_rows_offset,
+				0,
+				cursor_row - first_row + fix_rows_offset,
+				vcursor_xmin_fix, vcursor_xmax_fix,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_FIX_ROWS,
+				desc->title_rows + desc->fixed_rows - scrdesc->fix_rows_rows,
+				scrdesc->fix_cols_cols + cursor_col,
+				-1,
+				vcursor_xmin_data, vcursor_xmax_data,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_FOOTER,
+				first_data_row + first_row + scrdesc->rows_rows - fix_rows_offset,
+				footer_cursor_col,
+				cursor_row - first_row - scrdesc->rows_rows + fix_rows_offset,
+				-1, -1,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_ROWNUM_LUC,
+				0,
+				0,
+				0,
+				-1, -1,
+				desc, scrdesc, opts);
+
+	window_fill(WINDOW_ROWNUM,
+				first_data_row + first_row - fix_rows_offset,
+				0,
+				cursor_row - first_row + fix_rows_offset,
+				-1, -1,
+				desc, scrdesc, opts);
+
+	profile_end(PROFILE_WINDOW_FILL);
+	profile_begin(PROFILE_REFRESH);
+
+	if (w_luc(scrdesc))
+		wnoutrefresh(w_luc(scrdesc));
+	if (w_rows(scrdesc))
+		wnoutrefresh(w_rows(scrdesc));
+	if (w_fix_cols(scrdesc))
+		wnoutrefresh(w_fix_cols(scrdesc));
+	if (w_fix_rows(scrdesc))
+		wnoutrefresh(w_fix_rows(scrdesc));
+	if (w_footer(scrdesc))
+		wnoutrefresh(w_footer(scrdesc));
+	if (w_rownum(scrdesc))
+		wnoutrefresh(w_rownum(scrdesc));
+	if (w_rownum_luc(scrdesc))
+		wnoutrefresh(w_rownum_luc(scrdesc));
+
+	profile_end(PROFILE_REFRESH);
 }
 
 /*
@@ -2100,6 +2945,30 @@ number_width(int num)
 	return 8;
 }
 
+/*
+ * Writes number with thousands separators to buffer
+ */
+static char *
+format_count(char *buffer, int num)
+{
+	char	digits[20];
+	char   *ptr = buffer;
+	int		len, i;
+
+	len = snprintf(digits, sizeof(digits), "%d", num);
+
+	for (i = 0; i < len; i++)
+	{
+		if (i > 0 && (len - i) % 3 == 0)
+			*ptr++ = ',';
+		*ptr++ = digits[i];
+	}
+
+	*ptr = '\0';
+
+	return buffer;
+}
+
 /*
  * returns true when cursor is on footer window
  */
@@ -2122,11 +2991,14 @@ print_status(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 	int		maxy, maxx;
 	int		smaxy, smaxx;
 	char	buffer[200];
+	int		info_width;
 	WINDOW   *top_bar = w_top_bar(scrdesc);
 	WINDOW   *bottom_bar = w_bottom_bar(scrdesc);
 	Theme	*top_bar_theme = &scrdesc->themes[WINDOW_TOP_BAR];
 	Theme	*bottom_bar_theme = &scrdesc->themes[WINDOW_BOTTOM_BAR];
 
+	profile_begin(PROFILE_PRINT_STATUS);
+
 	/* do nothing when there are not top status bar */
 	if (scrdesc->top_bar_rows > 0)
 	{
@@ -2294,6 +3166,56 @@ print_status(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 			}
 		}
 
+		info_width = strlen(buffer);
+
+		if (desc->hidden_records)
+		{
+			char	filter_info[80];
+			char	visible[30];
+			char	total[30];
+
+			snprintf(filter_info, sizeof(filter_info), "rows %s of %s",
+					 format_count(visible, desc->nvisible_records),
+					 format_count(total, desc->nrecords));
+
+			/* the info is not displayed, when there is not free space */
+			if (maxx - info_width - (int) strlen(filter_info) - 4 >= 0)
+			{
+				info_width += strlen(filter_info) + 2;
+				mvwprintw(top_bar, 0, maxx - info_width - 2, "  %s", filter_info);
+			}
+		}
+
+		if (scrdesc->searchterm_size > 0)
+		{
+			SearchIndex *si = get_search_index(opts, scrdesc, desc);
+			char	search_info[80];
+			char	count[30];
+			char	position[30];
+			int		pos = 0;
+
+			if (scrdesc->found)
+				pos = search_index_position(si, scrdesc->found_row, scrdesc->found_start_bytes);
+
+			format_count(count, si->nmatches);
+
+			if (pos > 0)
+				snprintf(search_info, sizeof(search_info), "match %s of %s%s",
+						 format_count(position, pos),
+						 count,
+						 si->is_complete ? "" : "+");
+			else
+				snprintf(search_info, sizeof(search_info), "%s%s matches",
+						 count,
+						 si->is_complete ? "" : "+");
+
+			if (maxx - info_width - (int) strlen(search_info) - 4 >= 0)
+			{
+				info_width += strlen(search_info) + 2;
+				mvwprintw(top_bar, 0, maxx - info_width - 2, "  %s", search_info);
+			}
+		}
+
 		mvwprintw(top_bar, 0, maxx - strlen(buffer) - 2, "  %s", buffer);
 		wnoutrefresh(top_bar);
 	}
@@ -2357,6 +3279,8 @@ print_status(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
 
 		wattroff(bottom_bar, bottom_bar_theme->prompt_attr);
 	}
+
+	profile_end(PROFILE_PRINT_STATUS);
 }
 
 static void
@@ -2483,38 +3407,213 @@ got_string(char *line)
 }
 
 static void
-readline_redisplay()
+readline_redisplay()
+{
+	size_t cursor_col;
+
+	if (!force8bit)
+	{
+		size_t prompt_dsplen = utf_string_dsplen(rl_display_prompt, SIZE_MAX);
+
+		cursor_col = prompt_dsplen
+					  + readline_utf_string_dsplen(rl_line_buffer, rl_point, prompt_dsplen);
+	}
+	else
+	{
+		cursor_col = strlen(rl_display_prompt) + min_int(strlen(rl_line_buffer), rl_point);
+	}
+
+	wbkgd(g_bottom_bar, input_attr);
+	werase(g_bottom_bar);
+	mvwprintw(g_bottom_bar, 0, 0, "%s%s", rl_display_prompt, rl_line_buffer);
+	mvwchgat(g_bottom_bar, 0, 0, -1, input_attr, PAIR_NUMBER(input_attr), 0);
+
+	if (cursor_col >= COLS)
+		curs_set(0);
+	else
+	{
+		wmove(g_bottom_bar, 0, cursor_col);
+		curs_set(2);
+	}
+
+	wrefresh(g_bottom_bar);
+}
+
+
+#endif
+
+/*
+ * Save search related fields of scrdesc and activate incremental search
+ * for next get_string.
+ */
+static void
+incsearch_begin(IncSearchState *is, Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				bool backward, int search_column, int fd)
+{
+	is->opts = opts;
+	is->scrdesc = scrdesc;
+	is->desc = desc;
+	is->backward = backward;
+	is->search_column = search_column;
+	is->fd = fd;
+	is->pattern[0] = '\0';
+	is->canceled = false;
+	is->changed = false;
+
+	memcpy(is->saved.searchterm, scrdesc->searchterm, sizeof(scrdesc->searchterm));
+	is->saved.searchterm_size = scrdesc->searchterm_size;
+	is->saved.searchterm_char_size = scrdesc->searchterm_char_size;
+	is->saved.has_upperchr = scrdesc->has_upperchr;
+	is->saved.search_column = scrdesc->search_column;
+	is->saved.found = scrdesc->found;
+	is->saved.found_row = scrdesc->found_row;
+	is->saved.found_start_x = scrdesc->found_start_x;
+	is->saved.found_start_bytes = scrdesc->found_start_bytes;
+	is->saved.found_char_size = scrdesc->found_char_size;
+
+	incsearch = is;
+}
+
+/*
+ * Restore fields changed by preview. The entered pattern is processed
+ * like without incremental search.
+ */
+static void
+incsearch_end(void)
+{
+	IncSearchState *is = incsearch;
+
+	incsearch = NULL;
+
+	if (!is || !is->changed)
+		return;
+
+	memcpy(is->scrdesc->searchterm, is->saved.searchterm, sizeof(is->saved.searchterm));
+	is->scrdesc->searchterm_size = is->saved.searchterm_size;
+	is->scrdesc->searchterm_char_size = is->saved.searchterm_char_size;
+	is->scrdesc->has_upperchr = is->saved.has_upperchr;
+	set_search_column(is->scrdesc, is->desc, is->saved.search_column);
+	is->scrdesc->found = is->saved.found;
+	is->scrdesc->found_row = is->saved.found_row;
+	is->scrdesc->found_start_x = is->saved.found_start_x;
+	is->scrdesc->found_start_bytes = is->saved.found_start_bytes;
+	is->scrdesc->found_char_size = is->saved.found_char_size;
+
+	reset_searching_lineinfo(is->scrdesc, &is->desc->rows);
+}
+
+#ifdef HAVE_LIBREADLINE
+
+/*
+ * Search the pattern from saved cursor position and display first match.
+ */
+static void
+incsearch_preview(const char *pattern)
 {
-	size_t cursor_col;
-
-	if (!force8bit)
-	{
-		size_t prompt_dsplen = utf_string_dsplen(rl_display_prompt, SIZE_MAX);
-
-		cursor_col = prompt_dsplen
-					  + readline_utf_string_dsplen(rl_line_buffer, rl_point, prompt_dsplen);
-	}
-	else
+	IncSearchState *is = incsearch;
+	Options	   *opts = is->opts;
+	ScrDesc	   *scrdesc = is->scrdesc;
+	DataDesc   *desc = is->desc;
+	int			first_row = is->first_row;
+	int			cursor_row = is->cursor_row;
+	int			cursor_row_offset;
+	int			fix_rows_offset = is->fix_rows_offset;
+	int			first_data_row = is->first_data_row;
+	bool		saved_has_upperchr;
+	char		errbuf[256];
+
+	strncpy(is->pattern, pattern, sizeof(is->pattern) - 1);
+	is->pattern[sizeof(is->pattern) - 1] = '\0';
+	is->canceled = false;
+
+	/* search mode depends on upper chars in pattern */
+	saved_has_upperchr = scrdesc->has_upperchr;
+	scrdesc->has_upperchr = has_upperchr(opts, is->pattern);
+
+	/* incomplete regular expression is not searched */
+	if (opts->regex_search && *pattern &&
+		!check_regex(pattern,
+					 pspg_search_mode(opts, scrdesc) == SEARCH_IGNORE_CASE,
+					 errbuf, sizeof(errbuf)))
 	{
-		cursor_col = strlen(rl_display_prompt) + min_int(strlen(rl_line_buffer), rl_point);
+		scrdesc->has_upperchr = saved_has_upperchr;
+		return;
 	}
 
-	wbkgd(g_bottom_bar, input_attr);
-	werase(g_bottom_bar);
-	mvwprintw(g_bottom_bar, 0, 0, "%s%s", rl_display_prompt, rl_line_buffer);
-	mvwchgat(g_bottom_bar, 0, 0, -1, input_attr, PAIR_NUMBER(input_attr), 0);
+	is->changed = true;
 
-	if (cursor_col >= COLS)
-		curs_set(0);
-	else
+	memcpy(scrdesc->searchterm, is->pattern, sizeof(is->pattern));
+	scrdesc->searchterm_size = strlen(scrdesc->searchterm);
+	scrdesc->searchterm_char_size = opts->force8bit ? scrdesc->searchterm_size : utf8len(scrdesc->searchterm);
+	set_search_column(scrdesc, desc, is->search_column);
+	scrdesc->found = false;
+
+	reset_searching_lineinfo(scrdesc, &desc->rows);
+
+	cursor_row_offset = scrdesc->fix_rows_rows + desc->title_rows + fix_rows_offset;
+
+	if (scrdesc->searchterm_size > 0)
 	{
-		wmove(g_bottom_bar, 0, cursor_col);
-		curs_set(2);
+		SearchMatch	match;
+		SearchResult result;
+
+		result = search_rows_bounded(opts, scrdesc, desc,
+									 cursor_row + cursor_row_offset - (is->backward ? 1 : 0),
+									 is->backward, is->fd, INCSEARCH_TIME_BUDGET,
+									 &match);
+
+		/* the pattern will be searched again, when there are not pending keys */
+		if (result == SEARCH_RESULT_CANCELED)
+		{
+			is->canceled = true;
+			return;
+		}
+
+		if (result == SEARCH_RESULT_FOUND)
+		{
+			int		visible_rows = scrdesc->main_maxy - scrdesc->fix_rows_rows - fix_rows_offset;
+			int		max_first_row = desc->last_row - desc->title_rows - scrdesc->main_maxy + 1;
+
+			cursor_row = match.row - cursor_row_offset;
+
+			if (cursor_row < first_row)
+				first_row = cursor_row;
+			else if (cursor_row - first_row + 1 > visible_rows)
+				first_row = cursor_row - visible_rows + 1;
+
+			if (first_row > max_first_row)
+				first_row = max_first_row > 0 ? max_first_row : 0;
+
+			scrdesc->found = true;
+			scrdesc->found_row = match.row;
+			scrdesc->found_start_bytes = match.offset;
+			scrdesc->found_start_x = match.start_x;
+			scrdesc->found_char_size = match.end_x - match.start_x;
+		}
 	}
 
-	wrefresh(g_bottom_bar);
+	/* position of footer depends on first_row */
+	create_layout(opts, scrdesc, desc, first_data_row, first_row);
+
+	draw_data_windows(opts, scrdesc, desc,
+					  first_data_row, first_row, fix_rows_offset,
+					  cursor_row, is->cursor_col, is->footer_cursor_col,
+					  -1, -1, -1, -1);
+
+	/* terminal cursor should stay in prompt */
+	wnoutrefresh(w_bottom_bar(scrdesc));
+	doupdate();
 }
 
+/*
+ * Returns true, when the pattern in prompt was not searched yet
+ */
+static bool
+incsearch_is_pending(void)
+{
+	return incsearch &&
+		   (incsearch->canceled || strcmp(rl_line_buffer, incsearch->pattern) != 0);
+}
 
 #endif
 
@@ -2531,6 +3630,17 @@ get_string(Options *opts, ScrDesc *scrdesc, char *prompt, char *buffer, int maxs
 	mmask_t		prev_mousemask = 0;
 	bool	input_is_valid = true;
 
+#endif
+
+	/* in bench-render mode, the string is taken from script */
+	if (opts->bench_render)
+	{
+		bench_script_get_arg(buffer, maxsize);
+		return;
+	}
+
+#ifdef HAVE_LIBREADLINE
+
 	g_bottom_bar = bottom_bar;
 	got_readline_string = false;
 	force8bit = opts->force8bit;
@@ -2565,7 +3675,7 @@ get_string(Options *opts, ScrDesc *scrdesc, char *prompt, char *buffer, int maxs
 		wrefresh(bottom_bar);
 	}
 
-	wtimeout(bottom_bar, 100);
+	wtimeout(bottom_bar, 0);
 
 	while (!got_readline_string)
 	{
@@ -2579,6 +3689,15 @@ get_string(Options *opts, ScrDesc *scrdesc, char *prompt, char *buffer, int maxs
 
 			if (handle_sigint || errno == 4)
 				goto finish_read;
+
+			if (c == ERR || c == 0)
+			{
+				/* there are not other keys, so pattern can be searched now */
+				if (incsearch_is_pending())
+					incsearch_preview(rl_line_buffer);
+				else
+					(void) wait_for_event(-1);
+			}
 		}
 		while (c == ERR || c == 0);
 
@@ -2686,7 +3805,7 @@ finish_read:
 #define SEARCH_FORWARD			1
 #define SEARCH_BACKWARD			2
 
-static bool
+bool
 has_upperchr(Options *opts, char *str)
 {
 	if (opts->force8bit)
@@ -2713,20 +3832,26 @@ has_upperchr(Options *opts, char *str)
 	return false;
 }
 
+/*
+ * State of searching of all rows is unknown after change of pattern. The
+ * highlighting of displayed rows is changed too, so windows should be drawn
+ * fully.
+ */
 static void
-reset_searching_lineinfo(LineBuffer *lnb)
+reset_searching_lineinfo(ScrDesc *scrdesc, LineBuffer *lnb)
 {
+	memset(scrdesc->fill_state, 0, sizeof(scrdesc->fill_state));
+
 	while (lnb != NULL)
 	{
-		if (lnb->lineinfo != NULL)
-		{
-			int		i;
+		SearchInfo *si = lnb->searchinfo;
 
-			for (i = 0; i < lnb->nrows; i++)
-			{
-				lnb->lineinfo[i].mask |= LINEINFO_UNKNOWN;
-				lnb->lineinfo[i].mask &= ~(LINEINFO_FOUNDSTR | LINEINFO_FOUNDSTR_MULTI);
-			}
+		if (si != NULL)
+		{
+			memset(si->searched, 0, LINEINFO_BITMAP_SIZE);
+			memset(si->found, 0, LINEINFO_BITMAP_SIZE);
+			memset(si->found_multi, 0, LINEINFO_BITMAP_SIZE);
+			si->nstarts = 0;
 		}
 		lnb = lnb->next;
 	}
@@ -2835,7 +3960,7 @@ get_event(MEVENT *mevent, bool *alt, bool *sigint, int timeoutval)
 {
 	bool	first_event = true;
 	int		c;
-	int		loops = -1;
+	long	deadline = 0;
 
 #ifdef DEBUG_PIPE
 
@@ -2853,10 +3978,20 @@ get_event(MEVENT *mevent, bool *alt, bool *sigint, int timeoutval)
 	*alt = false;
 	*sigint = false;
 
+	/* in bench-render mode, commands are read from script */
+	if (profile_active)
+		return 0;
+
 repeat:
 
 	if (timeoutval != -1)
-		loops = timeoutval / 100;
+	{
+		time_t	sec;
+		long	ms;
+
+		current_time(&sec, &ms);
+		deadline = sec * 1000 + ms + timeoutval;
+	}
 
 	do
 	{
@@ -2887,10 +4022,29 @@ repeat:
 			break;
 		}
 
-		if (loops >= 0)
+		/*
+		 * ncurses doesn't wait (timeout is zero), so when there are not
+		 * any buffered keys, wait on next event here.
+		 */
+		if (c == 0 || c == ERR)
 		{
-			if (--loops == 0)
-				break;
+			long	wait = -1;
+
+			if (timeoutval != -1)
+			{
+				time_t	sec;
+				long	ms;
+
+				current_time(&sec, &ms);
+				wait = deadline - (sec * 1000 + ms);
+				if (wait <= 0)
+					break;
+			}
+
+			(void) wait_for_event(wait);
+
+			if (trace_dump_requested)
+				trace_dump();
 		}
 	}
 	/*
@@ -2935,6 +4089,8 @@ repeat:
 
 	*alt = !first_event;
 
+	trace_instant("input", c == KEY_MOUSE ? "mouse" : (c == KEY_RESIZE ? "resize" : "key"), "code", c);
+
 #ifdef DEBUG_PIPE
 
 	debug_eventno += 1;
@@ -2988,7 +4144,7 @@ exit_ncurses(void)
 		endwin();
 }
 
-static void
+void
 DataDescFree(DataDesc *desc)
 {
 	LineBuffer	   *lb = &desc->rows;
@@ -2999,17 +4155,69 @@ DataDescFree(DataDesc *desc)
 		int		i;
 
 		for (i = 0; i < lb->nrows; i++)
+		{
+			mem_free(MEM_ROWS, strlen(lb->rows[i]) + 1);
 			free(lb->rows[i]);
+		}
+
+		if (lb->bookmarks)
+		{
+			mem_free(MEM_LINEINFO, LINEINFO_BITMAP_SIZE);
+			free(lb->bookmarks);
+		}
+
+		if (lb->continuations)
+		{
+			mem_free(MEM_LINEINFO, LINEINFO_BITMAP_SIZE);
+			free(lb->continuations);
+		}
+
+		if (lb->searchinfo)
+		{
+			mem_free(MEM_LINEINFO, sizeof(SearchInfo) +
+								   lb->searchinfo->starts_size * sizeof(StartChar));
+			free(lb->searchinfo->starts);
+			free(lb->searchinfo);
+		}
+
+		if (lb->coloffsets)
+		{
+			for (i = 0; i < lb->nrows; i++)
+			{
+				if (lb->coloffsets[i])
+				{
+					mem_free(MEM_COLOFFSETS, desc->columns * sizeof(ColumnOffset));
+					free(lb->coloffsets[i]);
+				}
+			}
+
+			mem_free(MEM_COLOFFSETS, 1000 * sizeof(ColumnOffset *));
+			free(lb->coloffsets);
+		}
 
-		free(lb->lineinfo);
 		next = lb->next;
 		if (lb != &desc->rows)
+		{
+			mem_free(MEM_LINEBUFFERS, sizeof(LineBuffer));
 			free(lb);
+		}
 
 		lb = next;
 	}
 
-	free(desc->order_map);
+	/* size of filter's bitmap depends on number of records */
+	free_filter(desc);
+	free_sort_cache(desc);
+	free_column_data(desc);
+	free_search_index(desc);
+	free_bookmarks(desc);
+
+	if (desc->order_map)
+	{
+		mem_free(MEM_RECORDS, desc->total_rows * sizeof(MappedLine));
+		free(desc->order_map);
+	}
+
 	free(desc->headline_transl);
 	free(desc->cranges);
 }
@@ -3024,6 +4232,29 @@ current_time(time_t *sec, long *ms)
 	*sec = spec.tv_sec;
 }
 
+/*
+ * Returns true, when there are some unread input events
+ */
+bool
+is_input_pending(int fd)
+{
+	struct pollfd	fds;
+
+	fds.fd = fd;
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	return poll(&fds, 1, 0) > 0;
+}
+
+/*
+ * The benchmark driver (bench.c) is linked with this file, and it has
+ * own main function.
+ */
+#ifdef PSPG_BENCH
+#define main	pspg_main
+#endif
+
 int
 main(int argc, char *argv[])
 {
@@ -3037,6 +4268,8 @@ main(int argc, char *argv[])
 	long	last_ms = 0;							/* time of last mouse release in ms */
 	time_t	last_sec = 0;							/* time of last mouse release in sec */
 	long	next_watch = 0;
+	int		watch_timeout;
+	long	last_frame = 0;							/* time of last drawing in ms */
 	int		next_command = cmd_Invalid;
 	bool	reuse_event = false;
 	int		cursor_row = 0;
@@ -3057,6 +4290,7 @@ main(int argc, char *argv[])
 	bool	detected_format = false;
 	bool	no_alternate_screen = false;
 	int		fix_rows_offset = 0;
+	IncSearchState incsearch_state;
 
 	int		opt;
 	int		option_index = 0;
@@ -3077,11 +4311,15 @@ main(int argc, char *argv[])
 	bool	only_for_tables = false;
 	bool	no_interactive = false;
 	bool	raw_output_quit = false;
+	char   *trace_path = NULL;				/* file used for trace of events */
+	WINDOW *memstats_win = NULL;			/* memory usage overlay */
+	long	trace_start;
 
 	bool	mouse_was_initialized = false;
 
-	int		last_ordered_column = -1;			/* order by when watch mode is active */
-	bool	last_order_desc = false;			/* true, when sort of data is descend */
+	SortKey	sort_keys[MAX_SORT_KEYS];			/* order by when watch mode is active */
+	int		nsort_keys = 0;						/* number of used sort keys */
+	char	filter_expr[256];					/* active filter or empty string */
 
 	long	mouse_event = 0;
 	long	vertical_cursor_changed_mouse_event = 0;
@@ -3097,6 +4335,12 @@ main(int argc, char *argv[])
 		{"HILITE-SEARCH", no_argument, 0, 'G'},
 		{"ignore-case", no_argument, 0, 'i'},
 		{"IGNORE-CASE", no_argument, 0, 'I'},
+		{"regex", no_argument, 0, 25},
+		{"incsearch", no_argument, 0, 26},
+		{"bench-render", required_argument, 0, 27},
+		{"trace", required_argument, 0, 28},
+		{"stats", no_argument, 0, 29},
+		{"save-bookmarks", no_argument, 0, 30},
 		{"no-bars", no_argument, 0, 8},
 		{"no-mouse", no_argument, 0, 2},
 		{"no-sound", no_argument, 0, 3},
@@ -3141,6 +4385,8 @@ main(int argc, char *argv[])
 	opts.pathname = NULL;
 	opts.ignore_case = false;
 	opts.ignore_lower_case = false;
+	opts.regex_search = false;
+	opts.incremental_search = false;
 	opts.no_sound = false;
 	opts.no_mouse = false;
 	opts.less_status_bar = false;
@@ -3172,6 +4418,10 @@ main(int argc, char *argv[])
 	opts.force_password_prompt = false;
 	opts.password = NULL;
 	opts.dbname = NULL;
+	opts.bench_render = NULL;
+	opts.show_memstats = false;
+	opts.print_stats = false;
+	opts.save_bookmarks = false;
 
 	load_config(tilde("~/.pspgconf"), &opts);
 
@@ -3198,6 +4448,10 @@ main(int argc, char *argv[])
 				fprintf(stderr, "  --about                  about authors\n");
 				fprintf(stderr, "  --help                   show this help\n");
 				fprintf(stderr, "  -V, --version            show version\n\n");
+				fprintf(stderr, "  --bench-render FILE      run commands from FILE without terminal,\n");
+				fprintf(stderr, "                           and print times of frames\n");
+				fprintf(stderr, "  --trace FILE             write trace of events to FILE (on exit or SIGUSR1)\n");
+				fprintf(stderr, "  --stats                  print memory usage on exit\n");
 				fprintf(stderr, "\n");
 				fprintf(stderr, "  -f FILE                  open file\n");
 				fprintf(stderr, "  -F, --quit-if-one-screen\n");
@@ -3208,6 +4462,7 @@ main(int argc, char *argv[])
 				fprintf(stderr, "  --no-sigint-search-reset\n");
 				fprintf(stderr, "                           without reset searching on sigint (CTRL C)\n");
 				fprintf(stderr, "  --only-for-tables        use std pager when content is not table\n");
+				fprintf(stderr, "  --save-bookmarks         save bookmarks of file to ~/.pspg_bookmarks\n");
 				fprintf(stderr, "  --on-sigint-exit         without exit on sigint(CTRL C or Escape)\n");
 				fprintf(stderr, "\nOutput options:\n");
 				fprintf(stderr, "  -a                       force ascii\n");
@@ -3223,6 +4478,8 @@ main(int argc, char *argv[])
 				fprintf(stderr, "                           don't highlight lines for searches\n");
 				fprintf(stderr, "  -i --ignore-case         ignore case in searches that do not contain uppercase\n");
 				fprintf(stderr, "  -I --IGNORE-CASE         ignore case in all searches\n");
+				fprintf(stderr, "  --regex                  search patterns are extended regular expressions\n");
+				fprintf(stderr, "  --incsearch              search pattern already when it is typed\n");
 				fprintf(stderr, "\nInterface options:\n");
 				fprintf(stderr, "  -c N                     fix N columns (0..9)\n");
 				fprintf(stderr, "  --less-status-bar        status bar like less pager\n");
@@ -3347,6 +4604,24 @@ main(int argc, char *argv[])
 			case 24:
 				opts.double_header = true;
 				break;
+			case 25:
+				opts.regex_search = true;
+				break;
+			case 26:
+				opts.incremental_search = true;
+				break;
+			case 27:
+				opts.bench_render = optarg;
+				break;
+			case 28:
+				trace_path = optarg;
+				break;
+			case 29:
+				opts.print_stats = true;
+				break;
+			case 30:
+				opts.save_bookmarks = true;
+				break;
 			case 'V':
 				fprintf(stdout, "pspg-%s\n", PSPG_VERSION);
 
@@ -3466,14 +4741,43 @@ main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (opts.bench_render)
+	{
+		char	errbuf[256];
+
+		if (opts.watch_time)
+		{
+			fprintf(stderr, "cannot use watch mode together with bench-render\n");
+			exit(EXIT_FAILURE);
+		}
+
+		if (!bench_script_load(opts.bench_render, errbuf, sizeof(errbuf)))
+		{
+			fprintf(stderr, "%s\n", errbuf);
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	if (opts.less_status_bar)
 		opts.no_topbar = true;
 
+	/* the trace can be enabled without change of command line too */
+	if (!trace_path)
+		trace_path = getenv("PSPG_TRACE");
+
+	if (trace_path && *trace_path)
+	{
+		trace_init(trace_path);
+		signal(SIGUSR1, SigusrHandler);
+	}
+
 	setlocale(LC_ALL, "");
 
 	/* Don't use UTF when terminal doesn't use UTF */
 	opts.force8bit = strcmp(nl_langinfo(CODESET), "UTF-8") != 0;
 
+	trace_start = trace_begin();
+
 	if (opts.csv_format || opts.query)
 	{
 		/*
@@ -3485,6 +4789,8 @@ main(int argc, char *argv[])
 			exit(EXIT_FAILURE);
 		}
 
+		trace_end("load", "read_and_format", trace_start, "rows", desc.total_rows);
+
 		if (opts.watch_time > 0)
 		{
 			current_time(&last_watch_sec, &last_watch_ms);
@@ -3492,8 +4798,12 @@ main(int argc, char *argv[])
 		}
 	}
 	else
+	{
 		readfile(fp, &opts, &desc);
 
+		trace_end("load", "readfile", trace_start, "rows", desc.total_rows);
+	}
+
 	if (fp != NULL)
 	{
 		fclose(fp);
@@ -3519,7 +4829,11 @@ main(int argc, char *argv[])
 	}
 
 	if (desc.headline)
+	{
+		trace_start = trace_begin();
 		(void) translate_headline(&opts, &desc);
+		trace_end("load", "translate_headline", trace_start, NULL, 0);
+	}
 
 	detected_format = desc.headline_transl;
 
@@ -3582,7 +4896,16 @@ exit_while_01:
 		return 0;
 	}
 
-	if (!isatty(fileno(stdin)))
+	/* bookmarks are saved only for data from file */
+	if (opts.save_bookmarks && opts.pathname && !opts.query && !opts.bench_render)
+		load_bookmarks(&desc, tilde("~/.pspg_bookmarks"), opts.pathname);
+
+	if (opts.bench_render)
+	{
+		/* terminal is not required, commands are read from script */
+		noatty = false;
+	}
+	else if (!isatty(fileno(stdin)))
 	{
 		if (freopen("/dev/tty", "r", stdin) != NULL)
 			noatty = false;
@@ -3607,16 +4930,40 @@ exit_while_01:
 	else
 		noatty = false;
 
+	init_signal_pipe();
 	signal(SIGINT, SigintHandler);
 
 	atexit(exit_ncurses);
 
-	if (noatty)
+	if (opts.bench_render)
+	{
+		FILE   *devnull_out = fopen("/dev/null", "w");
+		FILE   *devnull_in = fopen("/dev/null", "r");
+
+		/*
+		 * The screen is written to /dev/null. The size of screen is
+		 * taken from terminfo or from LINES and COLUMNS variables.
+		 */
+		if (!devnull_out || !devnull_in || !newterm(NULL, devnull_out, devnull_in))
+		{
+			fprintf(stderr, "cannot to initialize terminal \"%s\"\n",
+					getenv("TERM") ? getenv("TERM") : "");
+			exit(EXIT_FAILURE);
+		}
+
+		/* there are not any input events */
+		input_fd = -1;
+		profile_active = true;
+	}
+	else if (noatty)
 		/* use stderr like stdin. This is fallback solution used by less */
 		newterm(termname(), stdout, stderr);
 	else
 		initscr();
 
+	if (!opts.bench_render)
+		input_fd = noatty ? fileno(stderr) : fileno(stdin);
+
 	active_ncurses = true;
 
 	if(!has_colors())
@@ -3628,13 +4975,16 @@ reinit_theme:
 
 	initialize_color_pairs(opts.theme, opts.bold_labels, opts.bold_cursor);
 
-	timeout(100);
+	timeout(0);
 
 	cbreak();
 	keypad(stdscr, TRUE);
 	curs_set(0);
 	noecho();
 
+	/* allow to use scrolling of terminal, when rows are scrolled */
+	idlok(stdscr, TRUE);
+
 	wbkgdset(stdscr, COLOR_PAIR(1));
 
 #ifdef NCURSES_EXT_FUNCS
@@ -3686,6 +5036,10 @@ reinit_theme:
 
 	trim_footer_rows(&opts, &desc);
 
+	trace_start = trace_begin();
+	detect_multilines(&opts, &desc);
+	trace_end("load", "detect_multilines", trace_start, "rows", desc.total_rows);
+
 	if (reinit)
 	{
 		ScrDesc		aux;
@@ -3705,10 +5059,12 @@ reinit_theme:
 		scrdesc.searchterm_char_size = aux.searchterm_char_size;
 		scrdesc.searchterm_size = aux.searchterm_size;
 		scrdesc.has_upperchr = aux.has_upperchr;
+		set_search_column(&scrdesc, &desc, aux.search_column);
 		scrdesc.found = aux.found;
 		scrdesc.found_start_x = aux.found_start_x;
 		scrdesc.found_start_bytes = aux.found_start_bytes;
 		scrdesc.found_row = aux.found_row;
+		scrdesc.found_char_size = aux.found_char_size;
 
 		memcpy(scrdesc.searchcolterm, aux.searchcolterm, 255);
 
@@ -3841,6 +5197,8 @@ reinit_theme:
 	rl_prep_term_function = NULL;
 
 	last_row_search[0] = '\0';
+	filter_expr[0] = '\0';
+	last_filter[0] = '\0';
 	last_col_search[0] = '\0';
 	last_line[0] = '\0';
 	last_path[0] = '\0';
@@ -3908,6 +5266,23 @@ reinit_theme:
 		 */
 		if (next_command == cmd_Invalid)
 		{
+			/*
+			 * Don't draw intermediate states, when next key (mouse wheel
+			 * event) is waiting already after cursor movement.
+			 */
+			if (!no_doupdate && scrdesc.fmt == NULL &&
+				is_cursor_move_command(command) &&
+				is_input_pending(input_fd))
+			{
+				long	ms;
+				time_t	sec;
+
+				current_time(&sec, &ms);
+
+				if (sec * 1000 + ms - last_frame < MAX_FRAME_INTERVAL)
+					no_doupdate = true;
+			}
+
 			if (!no_doupdate)
 			{
 				int		vcursor_xmin_fix = -1;
@@ -3951,69 +5326,18 @@ reinit_theme:
 							vcursor_xmin_fix = scrdesc.fix_cols_cols - 1;
 				}
 
-				window_fill(WINDOW_LUC,
-							desc.title_rows + desc.fixed_rows - scrdesc.fix_rows_rows,
-							0,
-							-1,
-							vcursor_xmin_fix, vcursor_xmax_fix,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_ROWS,
-							first_data_row + first_row - fix_rows_offset,
-							scrdesc.fix_cols_cols + cursor_col,
-							cursor_row - first_row + fix_rows_offset,
-							vcursor_xmin_data, vcursor_xmax_data,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_FIX_COLS,
-							first_data_row + first_row - fix_rows_offset,
-							0,
-							cursor_row - first_row + fix_rows_offset,
-							vcursor_xmin_fix, vcursor_xmax_fix,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_FIX_ROWS,
-							desc.title_rows + desc.fixed_rows - scrdesc.fix_rows_rows,
-							scrdesc.fix_cols_cols + cursor_col,
-							-1,
-							vcursor_xmin_data, vcursor_xmax_data,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_FOOTER,
-							first_data_row + first_row + scrdesc.rows_rows - fix_rows_offset,
-							footer_cursor_col,
-							cursor_row - first_row - scrdesc.rows_rows + fix_rows_offset,
-							-1, -1,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_ROWNUM_LUC,
-							0,
-							0,
-							0,
-							-1, -1,
-							&desc, &scrdesc, &opts);
-
-				window_fill(WINDOW_ROWNUM,
-							first_data_row + first_row - fix_rows_offset,
-							0,
-							cursor_row - first_row + fix_rows_offset,
-							-1, -1,
-							&desc, &scrdesc, &opts);
-
-				if (w_luc(&scrdesc))
-					wnoutrefresh(w_luc(&scrdesc));
-				if (w_rows(&scrdesc))
-					wnoutrefresh(w_rows(&scrdesc));
-				if (w_fix_cols(&scrdesc))
-					wnoutrefresh(w_fix_cols(&scrdesc));
-				if (w_fix_rows(&scrdesc))
-					wnoutrefresh(w_fix_rows(&scrdesc));
-				if (w_footer(&scrdesc))
-					wnoutrefresh(w_footer(&scrdesc));
-				if (w_rownum(&scrdesc))
-					wnoutrefresh(w_rownum(&scrdesc));
-				if (w_rownum_luc(&scrdesc))
-					wnoutrefresh(w_rownum_luc(&scrdesc));
+				trace_start = trace_begin();
+
+				draw_data_windows(&opts, &scrdesc, &desc,
+								  first_data_row, first_row, fix_rows_offset,
+								  cursor_row, cursor_col, footer_cursor_col,
+								  vcursor_xmin_fix, vcursor_xmax_fix,
+								  vcursor_xmin_data, vcursor_xmax_data);
+
+				if (opts.show_memstats)
+					refresh_memstats_overlay(&opts, &scrdesc, &memstats_win);
+
+				trace_end("repaint", "window_fill", trace_start, "first_row", first_row);
 			} /* !no_doupdate */
 
 #ifdef COMPILE_MENU
@@ -4025,6 +5349,9 @@ reinit_theme:
 			{
 				st_menu_post(menu);
 				st_menu_set_focus(menu, ST_MENU_FOCUS_FULL);
+
+				/* menu can cover any part of windows */
+				memset(scrdesc.fill_state, 0, sizeof(scrdesc.fill_state));
 			}
 
 #endif
@@ -4032,7 +5359,21 @@ reinit_theme:
 			if (no_doupdate)
 				no_doupdate = false;
 			else if (next_command == 0 || scrdesc.fmt != NULL)
+			{
+				long	ms;
+				time_t	sec;
+
+				trace_start = trace_begin();
+				profile_begin(PROFILE_REFRESH);
 				doupdate();
+				profile_end(PROFILE_REFRESH);
+				trace_end("repaint", "doupdate", trace_start, NULL, 0);
+
+				profile_frame_end();
+
+				current_time(&sec, &ms);
+				last_frame = sec * 1000 + ms;
+			}
 
 			if (scrdesc.fmt != NULL)
 			{
@@ -4076,7 +5417,58 @@ reinit_theme:
 				else
 					prev_event_is_mouse_press = false;
 
-				event_keycode = get_event(&event, &press_alt, &got_sigint, opts.watch_time > 0 ? 1000 : -1);
+				/*
+				 * Positions of searched pattern are collected by chunks
+				 * of rows, when user doesn't press any key. The counter
+				 * of found patterns is refreshed after every chunk.
+				 */
+				while (scrdesc.searchterm_size > 0 &&
+					   !desc.order_map_is_partial &&
+					   !get_search_index(&opts, &scrdesc, &desc)->is_complete &&
+					   !is_input_pending(input_fd))
+				{
+					trace_start = trace_begin();
+					search_index_scan(&opts, &scrdesc, &desc, SEARCH_INDEX_SCAN_ROWS);
+					trace_end("search", "search_index_scan", trace_start, "next_row",
+							  get_search_index(&opts, &scrdesc, &desc)->next_row);
+
+					print_status(&opts, &scrdesc, &desc, cursor_row, cursor_col, first_row, fix_rows_offset, vertical_cursor_column);
+					doupdate();
+				}
+
+				/*
+				 * In watch mode, wake up when displayed time (in seconds)
+				 * should be changed (just after). Without watch mode there
+				 * is not any timeout.
+				 */
+				if (opts.watch_time > 0)
+				{
+					long	ms;
+					time_t	sec;
+					long	td;
+
+					current_time(&sec, &ms);
+					td = (sec - last_watch_sec) * 1000 + ms - last_watch_ms;
+
+					watch_timeout = td >= 0 ? 1000 - td % 1000 + 1 : 1000;
+				}
+				else
+					watch_timeout = -1;
+
+				/*
+				 * In bench-render mode, the commands are taken from script,
+				 * and the application ends after last command.
+				 */
+				if (opts.bench_render)
+				{
+					next_command = bench_script_next();
+					if (next_command == cmd_Invalid)
+						break;
+
+					continue;
+				}
+
+				event_keycode = get_event(&event, &press_alt, &got_sigint, watch_timeout);
 
 				if (opts.watch_time)
 				{
@@ -4091,6 +5483,8 @@ reinit_theme:
 					{
 						DataDesc		desc2;
 
+						trace_start = trace_begin();
+
 						if (read_and_format(fp, &opts, &desc2, &err))
 						{
 							int		max_cursor_row;
@@ -4103,6 +5497,21 @@ reinit_theme:
 							if (desc.headline)
 								(void) translate_headline(&opts, &desc);
 
+							detect_multilines(&opts, &desc);
+
+							/* filter and sort keys are applied on new data */
+							if (filter_expr[0] != '\0')
+							{
+								char	errbuf[256];
+
+								if (!apply_filter(&opts, &desc, filter_expr, errbuf, sizeof(errbuf)))
+									filter_expr[0] = '\0';
+							}
+
+							if (nsort_keys > 0 || desc.hidden_records)
+								update_order_map(&opts, &scrdesc, &desc, sort_keys, nsort_keys,
+												 first_row + 3 * VISIBLE_DATA_ROWS);
+
 							detected_format = desc.headline_transl;
 							if (detected_format && desc.oid_name_table)
 								default_freezed_cols = 2;
@@ -4119,10 +5528,12 @@ reinit_theme:
 							scrdesc.searchterm_char_size = aux.searchterm_char_size;
 							scrdesc.searchterm_size = aux.searchterm_size;
 							scrdesc.has_upperchr = aux.has_upperchr;
+							set_search_column(&scrdesc, &desc, aux.search_column);
 							scrdesc.found = aux.found;
 					  		scrdesc.found_start_x = aux.found_start_x;
 							scrdesc.found_start_bytes = aux.found_start_bytes;
-							scrdesc.found_row = aux.found_row;
+							scrdesc.found_row = desc.order_map ? -1 : aux.found_row;
+							scrdesc.found_char_size = aux.found_char_size;
 
 							scrdesc.fmt = aux.fmt;
 							scrdesc.par = aux.par;
@@ -4139,18 +5550,20 @@ reinit_theme:
 							first_row = first_row > max_first_row ? max_first_row : first_row;
 
 							last_watch_sec = sec; last_watch_ms = ms;
+
+							trace_end("watch", "refresh", trace_start, "rows", desc.total_rows);
 						}
 						else
+						{
 							DataDescFree(&desc2);
+							trace_end("watch", "refresh failed", trace_start, NULL, 0);
+						}
 
 						if ((ct - next_watch) < (opts.watch_time * 1000))
 							next_watch = next_watch + 1000 * opts.watch_time;
 						else
 							next_watch = ct + 100 * opts.watch_time;
 
-						if (last_ordered_column != -1)
-							update_order_map(&opts, &scrdesc, &desc, last_ordered_column, last_order_desc);
-
 						clear();
 						refresh_scr = true;
 					}
@@ -4194,7 +5607,11 @@ reinit_theme:
 				scrdesc.searchterm_size = 0;
 				scrdesc.searchterm_char_size = 0;
 
-				reset_searching_lineinfo(&desc.rows);
+				reset_searching_lineinfo(&scrdesc, &desc.rows);
+				free_search_index(&desc);
+
+				/* the command is not executed, but match counter should be removed */
+				print_status(&opts, &scrdesc, &desc, cursor_row, cursor_col, first_row, fix_rows_offset, vertical_cursor_column);
 			}
 			else
 			{
@@ -4290,12 +5707,36 @@ hide_menu:
 
 		prev_first_row = first_row;
 
+		/*
+		 * Only commands, that move cursor or displayed part of data, don't
+		 * change the content of rows. After other commands the windows
+		 * should be drawn fully.
+		 */
+		if (command != cmd_Invalid && !is_cursor_move_command(command))
+			memset(scrdesc.fill_state, 0, sizeof(scrdesc.fill_state));
+
+		/*
+		 * When only first rows of data are sorted, then the sort is
+		 * finished on demand - before any command that can use other
+		 * rows, or when cursor or displayed rows can leave the sorted
+		 * rows. Cursor move commands (without jump to end) move by
+		 * one page at most, so two pages are safe.
+		 */
+		if (desc.order_map_is_partial && command != cmd_Invalid &&
+			(!is_cursor_move_command(command) ||
+			 command == cmd_CursorLastRow ||
+			 (cursor_row > first_row ? cursor_row : first_row) + 2 * VISIBLE_DATA_ROWS
+					> desc.order_map_sorted_records))
+			update_order_map(&opts, &scrdesc, &desc, sort_keys, nsort_keys, 0);
+
 #ifdef DEBUG_PIPE
 
 		fprintf(debug_pipe, "main switch: %s\n", cmd_string(command));
 
 #endif
 
+		trace_start = trace_begin();
+
 		if (command == cmd_Quit)
 			break;
 		else if (command == cmd_Invalid)
@@ -4317,7 +5758,8 @@ hide_menu:
 				scrdesc.searchterm_size = 0;
 				scrdesc.searchterm_char_size = 0;
 
-				reset_searching_lineinfo(&desc.rows);
+				reset_searching_lineinfo(&scrdesc, &desc.rows);
+				free_search_index(&desc);
 			}
 			else
 			{
@@ -4371,6 +5813,16 @@ hide_menu:
 				opts.ignore_case = true;
 				goto reset_search;
 
+			case cmd_RegexSearchToggle:
+				opts.regex_search = !opts.regex_search;
+				show_info_wait(&opts, &scrdesc, " regular expression search: %s ", opts.regex_search ? "on" : "off", false, true, true, false);
+				goto reset_search;
+
+			case cmd_IncSearchToggle:
+				opts.incremental_search = !opts.incremental_search;
+				show_info_wait(&opts, &scrdesc, " incremental search: %s ", opts.incremental_search ? "on" : "off", false, true, true, false);
+				break;
+
 			case cmd_USSearchSet:
 				opts.ignore_lower_case = true;
 				opts.ignore_case = false;
@@ -4385,7 +5837,8 @@ reset_search:
 				scrdesc.searchterm_size = 0;
 				scrdesc.searchterm_char_size = 0;
 
-				reset_searching_lineinfo(&desc.rows);
+				reset_searching_lineinfo(&scrdesc, &desc.rows);
+				free_search_index(&desc);
 				break;
 
 			case cmd_ShowTopBar:
@@ -4393,6 +5846,16 @@ reset_search:
 				refresh_scr = true;
 				break;
 
+			case cmd_ShowMemoryStats:
+				opts.show_memstats = !opts.show_memstats;
+
+				/* windows under closed overlay should be drawn again */
+				if (!opts.show_memstats)
+					refresh_memstats_overlay(&opts, &scrdesc, &memstats_win);
+
+				refresh_scr = true;
+				break;
+
 			case cmd_ShowBottomBar:
 				opts.no_commandbar = !opts.no_commandbar;
 				if (opts.no_commandbar)
@@ -4589,35 +6052,14 @@ reset_search:
 						}
 					}
 
-					refresh_scr = true;
-				}
-				break;
-
-			case cmd_FlushBookmarks:
-				{
-					LineBuffer *lnb = &desc.rows;
-					int		rownum_cursor_row;
-
-					while (lnb != NULL)
-					{
-						if (lnb->lineinfo != NULL)
-						{
-							rownum_cursor_row = 0;
-
-							while (rownum_cursor_row < lnb->nrows)
-							{
-								if ((lnb->lineinfo[rownum_cursor_row].mask & LINEINFO_BOOKMARK) != 0)
-									lnb->lineinfo[rownum_cursor_row].mask ^= LINEINFO_BOOKMARK;
-
-								rownum_cursor_row += 1;
-							}
-						}
-
-						lnb = lnb->next;
-					}
+					refresh_scr = true;
 				}
 				break;
 
+			case cmd_FlushBookmarks:
+				flush_bookmarks(&desc);
+				break;
+
 			case cmd_ToggleBookmark:
 				{
 					LineBuffer *lnb = &desc.rows;
@@ -4632,7 +6074,7 @@ reset_search:
 					else
 					{
 						/* skip first x LineBuffers */
-						while (_cursor_row > 1000)
+						while (_cursor_row >= 1000)
 						{
 							lnb = lnb->next;
 							_cursor_row -= 1000;
@@ -4641,91 +6083,18 @@ reset_search:
 						lnb_row = _cursor_row;
 					}
 
-					if (lnb->lineinfo == NULL)
-					{
-						lnb->lineinfo = malloc(1000 * sizeof(LineInfo));
-						if (lnb->lineinfo == NULL)
-							leave_ncurses("out of memory");
-
-						memset(lnb->lineinfo, 0, 1000 * sizeof(LineInfo));
-					}
-
-					lnb->lineinfo[lnb_row].mask ^= LINEINFO_BOOKMARK;
+					toggle_bookmark(&desc, lnb, lnb_row, cursor_row + CURSOR_ROW_OFFSET);
 				}
 				break;
 
 			case cmd_PrevBookmark:
 				{
-					LineBuffer *lnb = &desc.rows;
-					int		rownum_cursor_row;
-					int		rownum = 0;
-					bool	found = false;
-
-					/* start from previous line before cursor */
-					rownum_cursor_row = cursor_row + CURSOR_ROW_OFFSET - 1;
-
-					if (rownum_cursor_row >= 0)
-					{
-						if (desc.order_map)
-						{
-							while (rownum_cursor_row >= 0)
-							{
-								MappedLine *mp = &desc.order_map[rownum_cursor_row];
-
-								if (mp->lnb->lineinfo)
-								{
-									if ((mp->lnb->lineinfo[mp->lnb_row].mask & LINEINFO_BOOKMARK) != 0)
-									{
-										found = true;
-										rownum = rownum_cursor_row;
-										goto exit_search_prev_bookmark;
-									}
-								}
-
-								rownum_cursor_row -= 1;
-							}
-						}
-						else
-						{
-							/* skip first x LineBuffers */
-							while (rownum_cursor_row >= 1000 && lnb != NULL)
-							{
-								lnb = lnb->next;
-								rownum_cursor_row -= 1000;
-								rownum += 1000;
-							}
-
-							rownum += rownum_cursor_row;
-
-							while (lnb != NULL)
-							{
-								if (lnb->lineinfo != NULL)
-								{
-									if (rownum_cursor_row < 0)
-										rownum_cursor_row = lnb->nrows - 1;
-
-									while (rownum_cursor_row >= 0)
-									{
-										if ((lnb->lineinfo[rownum_cursor_row].mask & LINEINFO_BOOKMARK) != 0)
-										{
-											found = true;
-											goto exit_search_prev_bookmark;
-										}
-										rownum -= 1;
-										rownum_cursor_row -= 1;
-									}
-								}
-								else
-									rownum -= 1000;
-
-								lnb = lnb->prev;
-							}
-						}
-					}
+					int		rownum;
 
-exit_search_prev_bookmark:
+					/* search before cursor line */
+					rownum = find_bookmark(&desc, cursor_row + CURSOR_ROW_OFFSET, true);
 
-					if (found)
+					if (rownum >= CURSOR_ROW_OFFSET)
 					{
 						cursor_row = rownum - CURSOR_ROW_OFFSET;
 						if (cursor_row < first_row)
@@ -4738,71 +6107,13 @@ exit_search_prev_bookmark:
 
 			case cmd_NextBookmark:
 				{
-					LineBuffer *lnb = &desc.rows;
-					int		rownum_cursor_row;
-					int		rownum = 0;
-					bool	found = false;
-
-					/* start after (next line) cursor line */
-					rownum_cursor_row = cursor_row + CURSOR_ROW_OFFSET + 1;
-
-					if (desc.order_map)
-					{
-						while (rownum_cursor_row < desc.total_rows)
-						{
-							MappedLine *mp = &desc.order_map[rownum_cursor_row];
-
-							if (mp->lnb->lineinfo)
-							{
-								if ((mp->lnb->lineinfo[mp->lnb_row].mask & LINEINFO_BOOKMARK) != 0)
-								{
-									found = true;
-									rownum = rownum_cursor_row;
-									goto exit_search_next_bookmark;
-								}
-							}
-
-							rownum_cursor_row += 1;
-						}
-					}
-					else
-					{
-						/* skip first x LineBuffers */
-						while (rownum_cursor_row >= 1000 && lnb != NULL)
-						{
-							lnb = lnb->next;
-							rownum_cursor_row -= 1000;
-							rownum += 1000;
-						}
-
-						rownum += rownum_cursor_row;
-
-						while (lnb != NULL)
-						{
-							if (lnb->lineinfo != NULL)
-							{
-								while (rownum_cursor_row < lnb->nrows)
-								{
-									if ((lnb->lineinfo[rownum_cursor_row].mask & LINEINFO_BOOKMARK) != 0)
-									{
-										found = true;
-										goto exit_search_next_bookmark;
-									}
-									rownum += 1;
-									rownum_cursor_row += 1;
-								}
-							}
-							else
-								rownum += 1000;
-
-							rownum_cursor_row = 0;
-							lnb = lnb->next;
-						}
-					}
+					int		rownum;
 
-exit_search_next_bookmark:
+					/* search after cursor line */
+					rownum = find_bookmark(&desc, cursor_row + CURSOR_ROW_OFFSET, false);
 
-					if (found)
+					if (rownum >= CURSOR_ROW_OFFSET &&
+						rownum - CURSOR_ROW_OFFSET <= MAX_CURSOR_ROW)
 					{
 						int		max_first_row;
 
@@ -5469,33 +6780,90 @@ recheck_end:
 			case cmd_OriginalSort:
 				if (desc.order_map)
 				{
-					free(desc.order_map);
-					desc.order_map = NULL;
+					nsort_keys = 0;
 
-					last_ordered_column = -1;
+					/* filtered rows are displayed in original order */
+					update_order_map(&opts, &scrdesc, &desc, sort_keys, 0, 0);
 				}
 
-				/*
-				 * We cannot to say nothing about found_row, so most
-				 * correct solution is clean it now.
-				 */
-				scrdesc.found_row = -1;
-
 				break;
 
+			case cmd_Filter:
+				{
+					char	locfilter[256];
+					char	errbuf[256];
+
+					if (!desc.headline_transl && desc.first_data_row < 0)
+						break;
+
+					get_string(&opts, &scrdesc, "&", locfilter, sizeof(locfilter) - 1, last_filter);
+					memcpy(last_filter, locfilter, sizeof(last_filter));
+
+					if (locfilter[0] != '\0')
+					{
+						if (!apply_filter(&opts, &desc, locfilter, errbuf, sizeof(errbuf)))
+						{
+							show_info_wait(&opts, &scrdesc, " Cannot use filter: %s (press any key)", errbuf, true, true, false, true);
+							break;
+						}
+					}
+					else if (desc.hidden_records)
+						free_filter(&desc);
+					else
+						break;
+
+					memcpy(filter_expr, locfilter, sizeof(filter_expr));
+
+					update_order_map(&opts, &scrdesc, &desc, sort_keys, nsort_keys,
+									 3 * VISIBLE_DATA_ROWS);
+
+					cursor_row = 0;
+					first_row = 0;
+					scrdesc.found = false;
+
+					/* number of displayed rows can be less than before */
+					clear();
+					refresh_scr = true;
+					break;
+				}
+
 			case cmd_SortAsc:
 			case cmd_SortDesc:
+			case cmd_AddSortAsc:
+			case cmd_AddSortDesc:
 				{
 					if (opts.vertical_cursor && vertical_cursor_column > 0 && desc.columns > 0)
 					{
+						bool	desc_sort = command == cmd_SortDesc || command == cmd_AddSortDesc;
+						int		i;
+
+						if (command == cmd_SortAsc || command == cmd_SortDesc)
+							nsort_keys = 0;
+
+						/* when column is used already, then only direction is changed */
+						for (i = 0; i < nsort_keys; i++)
+						{
+							if (sort_keys[i].column == vertical_cursor_column)
+								break;
+						}
+
+						if (i == MAX_SORT_KEYS)
+						{
+							show_info_wait(&opts, &scrdesc, " Too many sort keys", NULL, true, true, true, false);
+							break;
+						}
+
+						sort_keys[i].column = vertical_cursor_column;
+						sort_keys[i].desc = desc_sort;
+						if (i == nsort_keys)
+							nsort_keys += 1;
+
 						update_order_map(&opts,
 										 &scrdesc,
 										 &desc,
-										 vertical_cursor_column,
-										 command == cmd_SortDesc);
-
-						last_ordered_column = vertical_cursor_column;
-						last_order_desc = command == cmd_SortDesc;
+										 sort_keys,
+										 nsort_keys,
+										 first_row + 3 * VISIBLE_DATA_ROWS);
 					}
 					else if (desc.columns == 0)
 						show_info_wait(&opts, &scrdesc, " Sort is available only for tables.", NULL, true, true, true, false);
@@ -5571,16 +6939,62 @@ exit:
 				}
 
 			case cmd_ForwardSearch:
+			case cmd_ForwardSearchInColumn:
 				{
 					char	locsearchterm[256];
+					char	errbuf[256];
+					int		search_column = 0;
+
+					if (command == cmd_ForwardSearchInColumn)
+					{
+						if (!opts.vertical_cursor || vertical_cursor_column <= 0 || desc.columns == 0)
+						{
+							show_info_wait(&opts, &scrdesc, " Vertical cursor is not visible", NULL, true, true, true, false);
+							break;
+						}
+
+						search_column = vertical_cursor_column;
+					}
+
+					if (opts.incremental_search)
+					{
+						incsearch_state.first_data_row = first_data_row;
+						incsearch_state.first_row = first_row;
+						incsearch_state.cursor_row = cursor_row;
+						incsearch_state.cursor_col = cursor_col;
+						incsearch_state.footer_cursor_col = footer_cursor_col;
+						incsearch_state.fix_rows_offset = fix_rows_offset;
+
+						incsearch_begin(&incsearch_state, &opts, &scrdesc, &desc, false, search_column,
+										noatty ? fileno(stderr) : fileno(stdin));
+					}
+
+					get_string(&opts, &scrdesc, search_column > 0 ? "c/" : "/", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
+
+					incsearch_end();
 
-					get_string(&opts, &scrdesc, "/", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
 					if (locsearchterm[0] != '\0')
 					{
 						memcpy(last_row_search, locsearchterm, sizeof(last_row_search));
 
 						strncpy(scrdesc.searchterm, locsearchterm, sizeof(scrdesc.searchterm));
 						scrdesc.has_upperchr = has_upperchr(&opts, scrdesc.searchterm);
+						set_search_column(&scrdesc, &desc, search_column);
+
+						if (opts.regex_search && !check_regex(scrdesc.searchterm,
+															  pspg_search_mode(&opts, &scrdesc) == SEARCH_IGNORE_CASE,
+															  errbuf, sizeof(errbuf)))
+						{
+							show_info_wait(&opts, &scrdesc, " Invalid regular expression: %s (press any key)", errbuf, true, true, false, true);
+
+							scrdesc.searchterm[0] = '\0';
+							scrdesc.searchterm_size = 0;
+							scrdesc.searchterm_char_size = 0;
+
+							reset_searching_lineinfo(&scrdesc, &desc.rows);
+							break;
+						}
+
 						scrdesc.searchterm_size = strlen(scrdesc.searchterm);
 						scrdesc.searchterm_char_size = opts.force8bit ? strlen(scrdesc.searchterm) : utf8len(scrdesc.searchterm);
 					}
@@ -5589,9 +7003,10 @@ exit:
 						scrdesc.searchterm[0] = '\0';
 						scrdesc.searchterm_size = 0;
 						scrdesc.searchterm_char_size = 0;
+						scrdesc.search_column = 0;
 					}
 
-					reset_searching_lineinfo(&desc.rows);
+					reset_searching_lineinfo(&scrdesc, &desc.rows);
 
 					search_direction = SEARCH_FORWARD;
 
@@ -5601,9 +7016,7 @@ exit:
 			case cmd_SearchNext:
 				{
 					int		rownum_cursor_row;
-					int		rownum = 0;
 					int		skip_bytes = 0;
-					LineBuffer   *lnb = &desc.rows;
 
 					/* call inverse command when search direction is SEARCH_BACKWARD */
 					if (command == cmd_SearchNext && search_direction == SEARCH_BACKWARD && !redirect_mode)
@@ -5614,81 +7027,13 @@ exit:
 
 					rownum_cursor_row = cursor_row + CURSOR_ROW_OFFSET;
 					if (scrdesc.found && rownum_cursor_row == scrdesc.found_row)
-						skip_bytes = scrdesc.found_start_bytes + scrdesc.searchterm_size;
-
-					scrdesc.found = false;
-
-					if (desc.order_map)
-					{
-						rownum = rownum_cursor_row;
-
-						while (rownum < desc.total_rows)
-						{
-							MappedLine *mp = &desc.order_map[rownum];
-							const char	   *str;
-							const char	   *rowstr;
-
-							rowstr = mp->lnb->rows[mp->lnb_row];
-							str = pspg_search(&opts, &scrdesc, rowstr + skip_bytes);
-							if (str != NULL)
-							{
-								scrdesc.found_start_x = opts.force8bit ? str - rowstr : utf8len_start_stop(rowstr, str);
-								scrdesc.found_start_bytes = str - rowstr;
-								scrdesc.found = true;
-								goto found_next_pattern;
-							}
-
-							rownum += 1;
-							skip_bytes = 0;
-						}
-					}
-					else
-					{
-						/* skip first x LineBuffers */
-						while (rownum_cursor_row > 1000 && lnb != NULL)
-						{
-							lnb = lnb->next;
-							rownum_cursor_row -= 1000;
-							rownum += 1000;
-						}
-
-						rownum += rownum_cursor_row;
-
-						while (lnb != NULL)
-						{
-							while (rownum_cursor_row < lnb->nrows)
-							{
-								const char	   *str;
-								const char	   *rowstr = lnb->rows[rownum_cursor_row];
-
-								str = pspg_search(&opts, &scrdesc, rowstr + skip_bytes);
-
-								if (str != NULL)
-								{
-									scrdesc.found_start_x = opts.force8bit ? str - rowstr : utf8len_start_stop(rowstr, str);
-									scrdesc.found_start_bytes = str - rowstr;
-									scrdesc.found = true;
-									goto found_next_pattern;
-								}
-
-								rownum += 1;
-								rownum_cursor_row += 1;
-								skip_bytes = 0;
-							}
+						skip_bytes = scrdesc.found_start_bytes + 1;
 
-							rownum_cursor_row = 0;
-							lnb = lnb->next;
-						}
-					}
-
-found_next_pattern:
-
-					if (scrdesc.found)
+					if (search_index_find(&opts, &scrdesc, &desc, rownum_cursor_row, skip_bytes, false))
 					{
 						int		max_first_row;
 
-						cursor_row = rownum - CURSOR_ROW_OFFSET;
-						scrdesc.found_row = rownum;
+						cursor_row = scrdesc.found_row - CURSOR_ROW_OFFSET;
 						fresh_found = true;
 						fresh_found_cursor_col = -1;
 
@@ -5707,16 +7052,62 @@ found_next_pattern:
 				}
 
 			case cmd_BackwardSearch:
+			case cmd_BackwardSearchInColumn:
 				{
 					char	locsearchterm[256];
+					char	errbuf[256];
+					int		search_column = 0;
+
+					if (command == cmd_BackwardSearchInColumn)
+					{
+						if (!opts.vertical_cursor || vertical_cursor_column <= 0 || desc.columns == 0)
+						{
+							show_info_wait(&opts, &scrdesc, " Vertical cursor is not visible", NULL, true, true, true, false);
+							break;
+						}
+
+						search_column = vertical_cursor_column;
+					}
+
+					if (opts.incremental_search)
+					{
+						incsearch_state.first_data_row = first_data_row;
+						incsearch_state.first_row = first_row;
+						incsearch_state.cursor_row = cursor_row;
+						incsearch_state.cursor_col = cursor_col;
+						incsearch_state.footer_cursor_col = footer_cursor_col;
+						incsearch_state.fix_rows_offset = fix_rows_offset;
+
+						incsearch_begin(&incsearch_state, &opts, &scrdesc, &desc, true, search_column,
+										noatty ? fileno(stderr) : fileno(stdin));
+					}
+
+					get_string(&opts, &scrdesc, search_column > 0 ? "c?" : "?", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
+
+					incsearch_end();
 
-					get_string(&opts, &scrdesc, "?", locsearchterm, sizeof(locsearchterm) - 1, last_row_search);
 					if (locsearchterm[0] != '\0')
 					{
 						memcpy(last_row_search, locsearchterm, sizeof(last_row_search));
 
 						strncpy(scrdesc.searchterm, locsearchterm, sizeof(scrdesc.searchterm));
 						scrdesc.has_upperchr = has_upperchr(&opts, scrdesc.searchterm);
+						set_search_column(&scrdesc, &desc, search_column);
+
+						if (opts.regex_search && !check_regex(scrdesc.searchterm,
+															  pspg_search_mode(&opts, &scrdesc) == SEARCH_IGNORE_CASE,
+															  errbuf, sizeof(errbuf)))
+						{
+							show_info_wait(&opts, &scrdesc, " Invalid regular expression: %s (press any key)", errbuf, true, true, false, true);
+
+							scrdesc.searchterm[0] = '\0';
+							scrdesc.searchterm_size = 0;
+							scrdesc.searchterm_char_size = 0;
+
+							reset_searching_lineinfo(&scrdesc, &desc.rows);
+							break;
+						}
+
 						scrdesc.searchterm_size = strlen(scrdesc.searchterm);
 						scrdesc.searchterm_char_size = utf8len(scrdesc.searchterm);
 					}
@@ -5725,9 +7116,10 @@ found_next_pattern:
 						scrdesc.searchterm[0] = '\0';
 						scrdesc.searchterm_size = 0;
 						scrdesc.searchterm_char_size = 0;
+						scrdesc.search_column = 0;
 					}
 
-					reset_searching_lineinfo(&desc.rows);
+					reset_searching_lineinfo(&scrdesc, &desc.rows);
 
 					search_direction = SEARCH_BACKWARD;
 
@@ -5736,9 +7128,7 @@ found_next_pattern:
 
 			case cmd_SearchPrev:
 				{
-					int		rowidx;
-					int		search_row;
-					LineBuffer   *rows = &desc.rows;
+					int		rownum_cursor_row;
 					int		cut_bytes = 0;
 
 					/* call inverse command when search direction is SEARCH_BACKWARD */
@@ -5748,118 +7138,24 @@ found_next_pattern:
 						break;
 					}
 
-					rowidx = cursor_row + scrdesc.fix_rows_rows + desc.title_rows;
-					search_row = cursor_row;
-
 					/*
 					 * when we can search on found line, the use it,
 					 * else try start searching from previous row.
 					 */
-					if (scrdesc.found && rowidx == scrdesc.found_row && scrdesc.found_start_bytes > 0)
+					rownum_cursor_row = cursor_row + CURSOR_ROW_OFFSET;
+					if (scrdesc.found && rownum_cursor_row == scrdesc.found_row)
 						cut_bytes = scrdesc.found_start_bytes;
-					else
-					{
-						rowidx -= 1;
-						search_row -= 1;
-					}
 
-					scrdesc.found = false;
-
-					if (desc.order_map)
+					if (search_index_find(&opts, &scrdesc, &desc, rownum_cursor_row, cut_bytes, true))
 					{
-						if (search_row > -1)
-						{
-							MappedLine *mp = &desc.order_map[rowidx];
+						cursor_row = scrdesc.found_row - CURSOR_ROW_OFFSET;
+						if (first_row > cursor_row)
+							first_row = cursor_row;
 
-							rows = mp->lnb;
-							rowidx = mp->lnb_row;
-						}
+						fresh_found = true;
+						fresh_found_cursor_col = -1;
 					}
 					else
-					{
-						/* go forward */
-						while (rowidx > 1000)
-						{
-							rows = rows->next;
-							rowidx -= 1000;
-						}
-					}
-
-					while (search_row >= 0)
-					{
-						const char *str;
-						char *row;
-						bool	free_row;
-
-						if (cut_bytes != 0)
-						{
-							row = malloc(strlen(rows->rows[rowidx]) + 1);
-							if (row == NULL)
-								leave_ncurses("out of memory");
-
-							strcpy(row, rows->rows[rowidx]);
-							row[cut_bytes] = '\0';
-							free_row = true;
-						}
-						else
-						{
-							row = rows->rows[rowidx];
-							free_row = false;
-						}
-
-						str = row;
-
-						/* try to find most right pattern */
-						while (str != NULL)
-						{
-							str = pspg_search(&opts, &scrdesc, str);
-
-							if (str != NULL)
-							{
-								cursor_row = search_row;
-								if (first_row > cursor_row)
-									first_row = cursor_row;
-
-								scrdesc.found_start_x = opts.force8bit ? str - row : utf8len_start_stop(row, str);
-								scrdesc.found_start_bytes = str - row;
-								scrdesc.found_row = cursor_row + CURSOR_ROW_OFFSET;
-								scrdesc.found = true;
-								fresh_found = true;
-								fresh_found_cursor_col = -1;
-
-								str += scrdesc.searchterm_size;
-							}
-						}
-
-						if (free_row)
-							free(row);
-
-						if (scrdesc.found)
-							break;
-
-						search_row -= 1;
-						cut_bytes = 0;
-
-						if (desc.order_map)
-						{
-							MappedLine *mp = &desc.order_map[search_row + scrdesc.fix_rows_rows + desc.title_rows];
-
-							rows = mp->lnb;
-							rowidx = mp->lnb_row;
-						}
-						else
-						{
-							rowidx -= 1;
-
-							if (rowidx < 0)
-							{
-								rows = rows->prev;
-								rowidx = 999;
-							}
-						}
-					}
-
-					if (!scrdesc.found)
 						show_info_wait(&opts, &scrdesc, " Not found (press any key)", NULL, true, true, false, false);
 
 					break;
@@ -6241,7 +7537,7 @@ found_next_pattern:
 			{
 				getmaxyx(w_fix_cols(&scrdesc), maxy, maxx);
 
-				if (scrdesc.found_start_x + scrdesc.searchterm_char_size <= maxx)
+				if (scrdesc.found_start_x + scrdesc.found_char_size <= maxx)
 					fresh_found = false;
 			}
 
@@ -6250,7 +7546,7 @@ found_next_pattern:
 				getmaxyx(w_rows(&scrdesc), maxy, maxx);
 
 				if (cursor_col + scrdesc.fix_cols_cols <= scrdesc.found_start_x &&
-						cursor_col + scrdesc.fix_cols_cols + maxx >= scrdesc.found_start_x + scrdesc.searchterm_char_size)
+						cursor_col + scrdesc.fix_cols_cols + maxx >= scrdesc.found_start_x + scrdesc.found_char_size)
 				{
 					fresh_found = false;
 				}
@@ -6259,7 +7555,7 @@ found_next_pattern:
 					/* we would to move cursor_col to left or right to be partially visible */
 					if (cursor_col + scrdesc.fix_cols_cols > scrdesc.found_start_x)
 						next_command = cmd_MoveLeft;
-					else if (cursor_col + scrdesc.fix_cols_cols + maxx < scrdesc.found_start_x + scrdesc.searchterm_char_size)
+					else if (cursor_col + scrdesc.fix_cols_cols + maxx < scrdesc.found_start_x + scrdesc.found_char_size)
 						next_command = cmd_MoveRight;
 				}
 			}
@@ -6269,7 +7565,7 @@ found_next_pattern:
 				getmaxyx(w_footer(&scrdesc), maxy, maxx);
 
 				if (footer_cursor_col + scrdesc.fix_cols_cols <= scrdesc.found_start_x &&
-						footer_cursor_col + maxx >= scrdesc.found_start_x + scrdesc.searchterm_char_size)
+						footer_cursor_col + maxx >= scrdesc.found_start_x + scrdesc.found_char_size)
 				{
 					fresh_found = false;
 				}
@@ -6278,7 +7574,7 @@ found_next_pattern:
 					/* we would to move cursor_col to left or right to be partially visible */
 					if (footer_cursor_col > scrdesc.found_start_x)
 						next_command = cmd_MoveLeft;
-					else if (footer_cursor_col + maxx < scrdesc.found_start_x + scrdesc.searchterm_char_size)
+					else if (footer_cursor_col + maxx < scrdesc.found_start_x + scrdesc.found_char_size)
 						next_command = cmd_MoveRight;
 				}
 			}
@@ -6317,6 +7613,8 @@ found_next_pattern:
 				fresh_found = false;
 		}
 
+		trace_end("command", cmd_string(command), trace_start, "cursor_row", cursor_row);
+
 		print_status(&opts, &scrdesc, &desc, cursor_row, cursor_col, first_row, fix_rows_offset, vertical_cursor_column);
 
 		if (first_row != prev_first_row)
@@ -6404,6 +7702,15 @@ refresh:
 				  footer_cursor_col, fix_rows_offset);
 	}
 
+	if (opts.bench_render)
+		profile_report(stdout);
+
+	if (opts.print_stats)
+		memstats_report(stdout);
+
+	if (opts.save_bookmarks && opts.pathname && !opts.query && !opts.bench_render)
+		save_bookmarks(&desc, tilde("~/.pspg_bookmarks"), opts.pathname);
+
 #ifdef HAVE_READLINE_HISTORY
 
 	write_history(tilde("~/.pspg_history"));
@@ -6430,8 +7737,22 @@ refresh:
 					free(lnb->rows[lnb_row]);
 			}
 
-			if (lnb->lineinfo)
-				free(lnb->lineinfo);
+			free(lnb->bookmarks);
+			free(lnb->continuations);
+
+			if (lnb->searchinfo)
+			{
+				free(lnb->searchinfo->starts);
+				free(lnb->searchinfo);
+			}
+
+			if (lnb->coloffsets)
+			{
+				for (lnb_row = 0; lnb_row < lnb->nrows; lnb_row++)
+					free(lnb->coloffsets[lnb_row]);
+
+				free(lnb->coloffsets);
+			}
 
 			_lnb = lnb;
 			lnb = lnb->next;
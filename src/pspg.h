@@ -18,27 +18,63 @@
 #include "themes.h"
 #include "st_menu.h"
 
-#define LINEINFO_NONE				0
-#define LINEINFO_BOOKMARK			1
-#define LINEINFO_FOUNDSTR			2
-#define LINEINFO_FOUNDSTR_MULTI		4
-#define LINEINFO_UNKNOWN			8
-#define LINEINFO_CONTINUATION		16
-
 #define MAX_STYLE					20
 
-typedef struct LineInfo
+#define MAX_SORT_KEYS				9
+
+/*
+ * Flags of rows of one LineBuffer are stored in bitmaps. The bitmaps
+ * are allocated, when some flag of this kind is set first time.
+ */
+#define LINEINFO_BITMAP_SIZE		((1000 >> 3) + 1)
+
+#define LINEINFO_IS_SET(bitmap, n)		((bitmap)[(n) >> 3] & (1 << ((n) & 7)))
+#define LINEINFO_SET(bitmap, n)			((bitmap)[(n) >> 3] |= (1 << ((n) & 7)))
+#define LINEINFO_CLEAR(bitmap, n)		((bitmap)[(n) >> 3] &= ~(1 << ((n) & 7)))
+
+/*
+ * Display position of first occurrence of search pattern in row
+ */
+typedef struct
 {
-	char			mask;
+	short int		row;
 	short int		start_char;
-} LineInfo;
+} StartChar;
+
+/*
+ * State of searching in rows of one LineBuffer. The state of rows, that
+ * are not marked as searched, is unknown, so reset of search state is
+ * just clearing of bitmaps. Start positions are stored only for rows
+ * with found pattern (sorted by row).
+ */
+typedef struct
+{
+	unsigned char	searched[LINEINFO_BITMAP_SIZE];
+	unsigned char	found[LINEINFO_BITMAP_SIZE];
+	unsigned char	found_multi[LINEINFO_BITMAP_SIZE];	/* more occurrences or regex */
+	StartChar	   *starts;
+	int				nstarts;
+	int				starts_size;
+} SearchInfo;
+
+/*
+ * Byte offset and display position of column's begin in some row
+ */
+typedef struct
+{
+	int		offset;
+	int		pos;
+} ColumnOffset;
 
 typedef struct LineBuffer
 {
-	int		first_row;
+	int		first_row;				/* number of first row of buffer */
 	int		nrows;
 	char   *rows[1000];
-	LineInfo	   *lineinfo;
+	unsigned char  *bookmarks;		/* bitmap of bookmarked rows or NULL */
+	unsigned char  *continuations;	/* bitmap of continual lines of multiline records or NULL */
+	SearchInfo	   *searchinfo;		/* state of searching in rows or NULL */
+	ColumnOffset  **coloffsets;		/* lazy offsets of columns per row or NULL */
 	struct LineBuffer *next;
 	struct LineBuffer *prev;
 } LineBuffer;
@@ -49,6 +85,13 @@ typedef struct
 	int				lnb_row;
 } MappedLine;
 
+typedef struct
+{
+	int				rowno;			/* number of row in input */
+	LineBuffer	   *lnb;
+	int				lnb_row;
+} Bookmark;
+
 typedef enum
 {
 	INFO_UNKNOWN,
@@ -63,8 +106,110 @@ typedef struct
 	char		   *strxfrm;
 	LineBuffer	   *lnb;
 	int				lnb_row;
+	int				seqno;			/* position of row in original order */
 } SortData;
 
+/*
+ * Typed values of one column. Values are indexed by number of record
+ * (continuation rows of multiline values are not counted).
+ */
+typedef struct
+{
+	bool			is_string;		/* true, when values are not numeric */
+	double		   *values;			/* numeric values */
+	char		  **strxfrm;		/* transformed strings of string column */
+	unsigned char  *nulls;			/* bitmap of rows with unknown value */
+} ColumnData;
+
+#define COLUMN_DATA_IS_NULL(cd, n)		((cd)->nulls[(n) >> 3] & (1 << ((n) & 7)))
+#define COLUMN_DATA_SET_NULL(cd, n)		((cd)->nulls[(n) >> 3] |= (1 << ((n) & 7)))
+
+#define RECORD_IS_HIDDEN(desc, n)		((desc)->hidden_records[(n) >> 3] & (1 << ((n) & 7)))
+#define RECORD_SET_HIDDEN(desc, n)		((desc)->hidden_records[(n) >> 3] |= (1 << ((n) & 7)))
+
+/* first row of record "dr" is continued by next row (multiline value) */
+#define RECORD_IS_CONTINUED(desc, dr)	((desc)->has_multilines && (dr)->lnb->continuations && \
+										 LINEINFO_IS_SET((dr)->lnb->continuations, (dr)->lnb_row))
+
+/*
+ * Sorted data of one column. Only ascending order is stored, descending
+ * order is created by reading of known values in reverse order.
+ */
+typedef struct
+{
+	SortData	   *sortbuf;		/* extracted values in ascending order */
+	int				nitems;			/* number of sorted data rows */
+	int				nvalid;			/* number of rows with known value */
+	int			   *ranks;			/* ranks of values indexed by seqno, -1 for unknown */
+	bool			is_string;		/* true, when column was sorted as text */
+} SortCache;
+
+typedef enum
+{
+	SEARCH_CASE_SENSITIVE,
+	SEARCH_IGNORE_CASE,
+	SEARCH_IGNORE_LOWER_CASE			/* only lower chars are case insensitive */
+} SearchMode;
+
+/*
+ * Position of found pattern. The row is number of displayed row (after
+ * order_map), the offset and size are in bytes. The start_x and end_x
+ * are positions in chars, and they are used for highlighting.
+ */
+typedef struct
+{
+	int		row;
+	int		offset;
+	int		size;
+	int		start_x;
+	int		end_x;
+} SearchMatch;
+
+/*
+ * Sorted positions of all occurrences of search pattern. The rows are
+ * processed by chunks when there are not user's events, so the index
+ * can be incomplete.
+ */
+typedef struct
+{
+	char			needle[256];	/* indexed pattern */
+	SearchMode		mode;
+	bool			force8bit;
+	bool			regex;			/* true, when needle is regular expression */
+	int				column;			/* searched column or zero for whole rows */
+	SearchMatch	   *matches;		/* found positions in displayed order */
+	int				nmatches;		/* number of found positions */
+	int				size;			/* size of matches array */
+	int				next_row;		/* first not processed row */
+	LineBuffer	   *lnb;			/* buffer of next row when order_map is not used */
+	int				lnb_row;
+	bool			is_complete;	/* true, when all rows are processed */
+} SearchIndex;
+
+#define SEARCH_INDEX_SCAN_ROWS		10000
+
+/*
+ * Result of bounded searching used by incremental search
+ */
+typedef enum
+{
+	SEARCH_RESULT_FOUND,
+	SEARCH_RESULT_NOT_FOUND,
+	SEARCH_RESULT_TIMEOUT,			/* time budget is over */
+	SEARCH_RESULT_CANCELED			/* some input is pending */
+} SearchResult;
+
+#define SEARCH_CHECK_ROWS			1000		/* rows processed by one step */
+
+/*
+ * Sort key - column and direction
+ */
+typedef struct
+{
+	int		column;					/* sorted column, starts by 1 */
+	bool	desc;					/* true, when descend order is used */
+} SortKey;
+
 /*
  * Column range
  */
@@ -103,6 +248,27 @@ typedef struct
 	LineBuffer rows;				/* list of rows buffers */
 	int		total_rows;				/* number of input rows */
 	MappedLine   *order_map;		/* maps sorted lines to original lines */
+	MappedLine *records;			/* data rows without continuation rows */
+	int		nrecords;				/* number of records */
+	ColumnData *column_data;		/* typed values per column or NULL */
+	SortCache  *sort_cache;			/* sorted data per column or NULL */
+	SearchIndex *search_index;		/* positions of searched pattern or NULL */
+	SortKey	sort_keys[MAX_SORT_KEYS];	/* keys used for order_map */
+	int		nsort_keys;				/* number of used sort keys */
+	bool	order_map_is_partial;	/* only first rows of order_map are sorted */
+	int		order_map_sorted_records;	/* number of sorted records of partial order_map */
+	unsigned char *hidden_records;	/* bitmap of records hidden by filter or NULL */
+	int		nvisible_records;		/* number of records shown by filter */
+	int		hidden_rows;			/* number of data rows hidden by filter */
+	Bookmark   *bookmarks;			/* bookmarks sorted by number of row or NULL */
+	int		nbookmarks;				/* number of bookmarks */
+	int		bookmarks_size;			/* allocated size of bookmarks */
+	int	   *bookmark_positions;		/* sorted positions of bookmarks in order map */
+	int		nbookmark_positions;	/* number of bookmarks in order map */
+	bool	bookmark_positions_valid;	/* false, when order map was changed */
+	bool	bookmarks_changed;		/* bookmarks should be saved */
+	long	bookmarks_file_size;	/* size of file, when bookmarks were loaded */
+	long	bookmarks_file_mtime;	/* mtime of file, when bookmarks were loaded */
 	int		maxy;					/* maxy of used pad area with data */
 	int		maxx;					/* maxx of used pad area with data */
 	int		maxbytes;				/* max length of line in bytes */
@@ -125,8 +291,24 @@ typedef struct
 	int		footer_rows;			/* number of footer rows */
 	bool	oid_name_table;			/* detected system table with first oid column */
 	bool	multilines_already_tested;	/* true, when we know where are multilines */
+	bool	has_multilines;			/* true, when some row has continuation row */
 } DataDesc;
 
+/*
+ * Parameters of last filling of window. When only the displayed rows or
+ * cursor are changed, then the content of window is scrolled, and only
+ * new rows and cursor rows are drawn again.
+ */
+typedef struct
+{
+	bool	is_valid;				/* false, when window should be drawn fully */
+	int		srcy;
+	int		srcx;
+	int		cursor_row;
+	int		vcursor_xmin;
+	int		vcursor_xmax;
+} FillState;
+
 /*
  * This structure can be mutable - depends on displayed data
  */
@@ -145,14 +327,19 @@ typedef struct
 	int		top_bar_rows;			/* 1 or 0 when top bar is not used */
 	WINDOW	*wins[9];
 	Theme	themes[9];
+	FillState	fill_state[9];		/* used for incremental drawing of windows */
 	char	searchterm[256];		/* currently active search input */
 	int		searchterm_char_size;	/* size of searchterm in chars */
 	int		searchterm_size;		/* size of searchterm in bytes */
 	bool	has_upperchr;			/* true, when search term has upper char */
+	int		search_column;			/* searching is limited to this column when > 0 */
+	int		search_col_minx;		/* first display position of searched column */
+	int		search_col_maxx;		/* last display position of searched column */
 	bool	found;					/* true, when last search was successfull */
 	int		found_start_x;			/* x position of found pattern */
 	int		found_start_bytes;		/* bytes position of found pattern */
 	int		found_row;				/* row of found pattern */
+	int		found_char_size;		/* size of found pattern in chars */
 	int		first_rec_title_y;		/* y of first displayed record title in expanded mode */
 	int		last_rec_title_y;		/* y of last displayed record title in expanded mode */
 	char	searchcolterm[256];		/* last searched column patterm */
@@ -205,9 +392,40 @@ typedef struct
 	bool	multilines[1024];		/* true if column has multiline row */
 } PrintDataDesc;
 
+/*
+ * Counters of time spent in one frame (used by --bench-render)
+ */
+typedef enum
+{
+	PROFILE_WINDOW_FILL,
+	PROFILE_PRINT_STATUS,
+	PROFILE_REFRESH,
+	PROFILE_FRAME,					/* time from end of previous frame */
+	PROFILE_COUNTERS
+} ProfileCounter;
+
+/*
+ * Categories of accounted memory (used by memory usage overlay and --stats)
+ */
+typedef enum
+{
+	MEM_ROWS,						/* text of rows */
+	MEM_LINEBUFFERS,				/* LineBuffer nodes */
+	MEM_LINEINFO,					/* bitmaps of bookmarks, search state, .. */
+	MEM_COLOFFSETS,					/* column offsets of rows */
+	MEM_RECORDS,					/* records and order map */
+	MEM_COLUMN_DATA,				/* extracted values of columns */
+	MEM_SORT,						/* sort cache and buffers */
+	MEM_SEARCH,						/* search index */
+	MEM_FILTER,						/* bitmap of hidden records */
+	MEM_CSV,						/* buckets of csv or query result */
+	MEM_CATEGORIES
+} MemCategory;
+
 /* from print.c */
 extern void window_fill(int window_identifier, int srcy, int srcx, int cursor_row, int vcursor_xmin, int vcursor_xmax, DataDesc *desc, ScrDesc *scrdesc, Options *opts);
 extern void draw_data(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int first_data_row, int first_row, int cursor_col, int footer_cursor_col, int fix_rows_offset);
+extern ColumnOffset *get_column_offsets(Options *opts, DataDesc *desc, LineBuffer *lnb, int lnb_row);
 
 /* from pspg.c */
 extern void leave_ncurses(const char *str);
@@ -216,7 +434,19 @@ extern int min_int(int a, int b);
 extern const char *nstrstr(const char *haystack, const char *needle);
 extern const char *nstrstr_ignore_lower_case(const char *haystack, const char *needle);
 
-extern const char *pspg_search(Options *opts, ScrDesc *scrdesc, const char *str);
+extern bool has_upperchr(Options *opts, char *str);
+extern bool is_input_pending(int fd);
+extern char *get_column_text(Options *opts, DataDesc *desc, char *str, int colno, bool is_continued, int *size);
+extern void prepare_records(Options *opts, DataDesc *desc);
+extern ColumnData *get_column_data(Options *opts, DataDesc *desc, int colno);
+extern SearchMode pspg_search_mode(Options *opts, ScrDesc *scrdesc);
+extern const char *pspg_search(Options *opts, ScrDesc *scrdesc, DataDesc *desc, LineBuffer *lnb, int lnb_row, const char *rowstr, const char *str, int *match_size);
+extern int readfile(FILE *fp, Options *opts, DataDesc *desc);
+extern bool translate_headline(Options *opts, DataDesc *desc);
+extern void trim_footer_rows(Options *opts, DataDesc *desc);
+extern void detect_multilines(Options *opts, DataDesc *desc);
+extern void update_order_map(Options *opts, ScrDesc *scrdesc, DataDesc *desc, SortKey *keys, int nkeys, int limit);
+extern void DataDescFree(DataDesc *desc);
 
 /* from menu.c */
 extern void init_menu_config(Options *opts);
@@ -224,9 +454,39 @@ extern struct ST_MENU *init_menu(struct ST_MENU *current_menu);
 extern struct ST_CMDBAR *init_cmdbar(struct ST_CMDBAR *current_cmdbar);
 extern void post_menu(Options *opts, struct ST_MENU *current_menu);
 
+/* from search.c */
+extern const char *search_pattern(const char *haystack, const char *needle, SearchMode mode, bool force8bit);
+extern const char *search_pattern_bounded(const char *haystack, int haystack_size, const char *needle, SearchMode mode, bool force8bit);
+extern bool check_regex(const char *pattern, bool icase, char *errbuf, int errbuf_size);
+extern const char *search_regex(const char *rowstr, const char *str, const char *pattern, bool icase, int *match_size);
+extern void set_search_column(ScrDesc *scrdesc, DataDesc *desc, int colno);
+extern const char *search_in_column(Options *opts, ScrDesc *scrdesc, DataDesc *desc, LineBuffer *lnb, int lnb_row, const char *rowstr, const char *str, int *match_size);
+extern SearchIndex *get_search_index(Options *opts, ScrDesc *scrdesc, DataDesc *desc);
+extern void free_search_index(DataDesc *desc);
+extern bool search_index_scan(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int nrows);
+extern bool search_index_find(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int row, int offset, bool backward);
+extern int search_index_position(SearchIndex *si, int row, int offset);
+extern SearchResult search_rows_bounded(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int row, bool backward, int fd, int budget_ms, SearchMatch *match);
+extern bool search_index_row(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int row, SearchMatch **matches, int *nmatches);
+
+/* from filter.c */
+extern bool apply_filter(Options *opts, DataDesc *desc, const char *expr, char *errbuf, int errbuf_size);
+extern void free_filter(DataDesc *desc);
+
+/* from bookmarks.c */
+extern void toggle_bookmark(DataDesc *desc, LineBuffer *lnb, int lnb_row, int position);
+extern void flush_bookmarks(DataDesc *desc);
+extern void invalidate_bookmark_positions(DataDesc *desc);
+extern int find_bookmark(DataDesc *desc, int position, bool backward);
+extern void free_bookmarks(DataDesc *desc);
+extern void load_bookmarks(DataDesc *desc, const char *bookmarks_path, const char *pathname);
+extern void save_bookmarks(DataDesc *desc, const char *bookmarks_path, const char *pathname);
+
 /* from sort.c */
 extern void sort_column_num(SortData *sortbuf, int rows, bool desc);
 extern void sort_column_text(SortData *sortbuf, int rows, bool desc);
+extern void sort_rows_by_ranks(int *rownums, int rows, int **ranks, bool *desc, int nkeys);
+extern int select_top_rows(SortData *sortbuf, int rows, int limit, bool is_string, bool desc, int *result);
 
 /* from pretty-csv.c */
 extern bool read_and_format(FILE *fp, Options *opts, DataDesc *desc, const char **err);
@@ -234,6 +494,34 @@ extern bool read_and_format(FILE *fp, Options *opts, DataDesc *desc, const char
 /* from pgclient.c */
 extern bool pg_exec_query(Options *opts, RowBucketType *rb, PrintDataDesc *pdesc, const char **err);
 
+/* from profile.c */
+extern bool profile_active;
+
+extern bool bench_script_load(const char *path, char *errbuf, int errbuf_size);
+extern int bench_script_next(void);
+extern void bench_script_get_arg(char *buffer, int maxsize);
+extern void profile_begin(ProfileCounter counter);
+extern void profile_end(ProfileCounter counter);
+extern void profile_frame_end(void);
+extern void profile_report(FILE *fp);
+
+/* from trace.c */
+extern bool trace_active;
+extern volatile bool trace_dump_requested;
+
+extern void trace_init(const char *path);
+extern long trace_begin(void);
+extern void trace_end(const char *cat, const char *name, long start, const char *argname, long arg);
+extern void trace_instant(const char *cat, const char *name, const char *argname, long arg);
+extern void trace_dump(void);
+
+/* from memstats.c */
+extern void mem_alloc(MemCategory cat, long size);
+extern void mem_free(MemCategory cat, long size);
+extern void memstats_report(FILE *fp);
+extern void memstats_overlay_size(int *rows, int *cols);
+extern void memstats_draw(WINDOW *win, attr_t data_attr, attr_t line_attr);
+
 /*
  * REMOVE THIS COMMENT FOR DEBUG OUTPUT
  * and modify a path.
@@ -0,0 +1,1225 @@
+/*-------------------------------------------------------------------------
+ *
+ * search.c
+ *	  fast searching of pattern in rows
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/search.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <ctype.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pspg.h"
+#include "unicode.h"
+
+/*
+ * Preprocessed pattern for Boyer-Moore-Horspool searching. The pattern
+ * is compared byte by byte. The bytes are folded by "fold" table, when
+ * the position of pattern is case insensitive.
+ */
+typedef struct
+{
+	char			needle[256];		/* source pattern */
+	SearchMode		mode;
+	bool			force8bit;
+	bool			is_valid;
+	bool			use_horspool;		/* false, when generic utf8 search is required */
+	bool			has_fold_exceptions;	/* some non ascii chars are folded to pattern's chars */
+	int				size;				/* size of pattern in bytes */
+	unsigned char	pattern[256];
+	bool			exact[256];			/* true, when position is case sensitive */
+	unsigned char	fold[256];			/* case folding of bytes */
+	int				skip[256];			/* Horspool shift table */
+} SearchPattern;
+
+static SearchPattern current_pattern;
+
+/*
+ * In utf8, the chars "Long S" and "Kelvin sign" are folded to ascii chars
+ * "s" and "k". They are matched by case insensitive positions of pattern
+ * with these chars, so the matched string can be longer than pattern.
+ */
+#define LONG_S_UTF8				"\305\277"
+#define KELVIN_SIGN_UTF8		"\342\204\252"
+
+static inline bool
+pattern_char_eq(SearchPattern *sp, int pos, unsigned char c)
+{
+	if (sp->exact[pos])
+		return sp->pattern[pos] == c;
+	else
+		return sp->fold[sp->pattern[pos]] == sp->fold[c];
+}
+
+static bool
+is_ascii_str(const char *str)
+{
+	while (*str)
+	{
+		if ((unsigned char) *str >= 0x80)
+			return false;
+		str += 1;
+	}
+
+	return true;
+}
+
+/*
+ * Prepare searching pattern. Horspool searching is used every time for
+ * case sensitive searching and for 8bit encoding. For utf8 encoding and
+ * case insensitive searching, it is used only when the pattern is ascii
+ * (utf8 continuation bytes cannot to match ascii chars).
+ */
+static void
+compile_pattern(SearchPattern *sp, const char *needle, SearchMode mode, bool force8bit)
+{
+	int		i, j;
+
+	strncpy(sp->needle, needle, sizeof(sp->needle) - 1);
+	sp->needle[sizeof(sp->needle) - 1] = '\0';
+
+	sp->mode = mode;
+	sp->force8bit = force8bit;
+	sp->is_valid = true;
+	sp->has_fold_exceptions = false;
+	sp->size = strlen(sp->needle);
+
+	sp->use_horspool = mode == SEARCH_CASE_SENSITIVE || force8bit || is_ascii_str(sp->needle);
+	if (!sp->use_horspool)
+		return;
+
+	for (i = 0; i < 256; i++)
+	{
+		if (mode == SEARCH_CASE_SENSITIVE)
+			sp->fold[i] = i;
+		else if (force8bit)
+			sp->fold[i] = toupper(i);
+		else
+			sp->fold[i] = i < 0x80 ? toupper(i) : i;
+	}
+
+	for (i = 0; i < sp->size; i++)
+	{
+		unsigned char	c = sp->needle[i];
+
+		sp->pattern[i] = c;
+
+		if (mode == SEARCH_CASE_SENSITIVE)
+			sp->exact[i] = true;
+		else if (mode == SEARCH_IGNORE_LOWER_CASE)
+			sp->exact[i] = isupper(c);
+		else
+			sp->exact[i] = false;
+
+		if (!force8bit && !sp->exact[i] &&
+			(sp->fold[c] == 'S' || sp->fold[c] == 'K'))
+			sp->has_fold_exceptions = true;
+	}
+
+	for (i = 0; i < 256; i++)
+	{
+		sp->skip[i] = sp->size;
+
+		for (j = 0; j < sp->size - 1; j++)
+		{
+			if (pattern_char_eq(sp, j, i))
+				sp->skip[i] = sp->size - 1 - j;
+		}
+	}
+
+	/*
+	 * Any byte of folded exception char can be under end of window. The
+	 * shift cannot be longer than the number of bytes of rest of match.
+	 */
+	if (sp->has_fold_exceptions)
+	{
+		for (j = 0; j < sp->size; j++)
+		{
+			const char *seq;
+			int			seqlen;
+			int			k;
+
+			if (sp->exact[j])
+				continue;
+
+			if (sp->fold[sp->pattern[j]] == 'S')
+				seq = LONG_S_UTF8;
+			else if (sp->fold[sp->pattern[j]] == 'K')
+				seq = KELVIN_SIGN_UTF8;
+			else
+				continue;
+
+			seqlen = strlen(seq);
+
+			for (k = 0; k < seqlen; k++)
+			{
+				unsigned char	c = seq[k];
+				int		shift = (seqlen - 1 - k) + (sp->size - 1 - j);
+
+				if (shift > 0 && shift < sp->skip[c])
+					sp->skip[c] = shift;
+			}
+		}
+	}
+}
+
+/*
+ * Returns size of "Long S" or "Kelvin sign" ending on position pos, when
+ * it is folded to char c. Else returns 0.
+ */
+static inline int
+fold_exception_size(unsigned char c, const unsigned char *str, long pos)
+{
+	if (c == 'S' && pos >= 1 &&
+		str[pos] == 0277 && str[pos - 1] == 0305)
+		return 2;
+
+	if (c == 'K' && pos >= 2 &&
+		str[pos] == 0252 && str[pos - 1] == 0204 && str[pos - 2] == 0342)
+		return 3;
+
+	return 0;
+}
+
+/*
+ * Compares pattern with string ending on position pos. Returns position
+ * of begin of match or -1.
+ */
+static long
+match_pattern(SearchPattern *sp, const unsigned char *str, long pos)
+{
+	int			j;
+
+	for (j = sp->size - 1; j >= 0; j--)
+	{
+		if (pos >= 0 && pattern_char_eq(sp, j, str[pos]))
+			pos -= 1;
+		else if (sp->has_fold_exceptions && !sp->exact[j])
+		{
+			int		size = fold_exception_size(sp->fold[sp->pattern[j]], str, pos);
+
+			if (size == 0)
+				return -1;
+
+			pos -= size;
+		}
+		else
+			return -1;
+	}
+
+	return pos + 1;
+}
+
+static const char *
+horspool_search(SearchPattern *sp, const char *haystack, size_t haystack_size)
+{
+	const unsigned char *str = (const unsigned char *) haystack;
+	size_t		pos = 0;
+	int			last = sp->size - 1;
+
+	if (sp->size == 0)
+		return haystack;
+
+	if (haystack_size < (size_t) sp->size)
+		return NULL;
+
+	while (pos <= haystack_size - sp->size)
+	{
+		unsigned char	c = str[pos + last];
+
+		if (pattern_char_eq(sp, last, c) ||
+			(sp->has_fold_exceptions && (c == 0277 || c == 0252)))
+		{
+			long	start = match_pattern(sp, str, pos + last);
+
+			if (start >= 0)
+				return haystack + start;
+		}
+
+		pos += sp->skip[c];
+	}
+
+	return NULL;
+}
+
+/*
+ * The preprocessed pattern is reused until the needle or mode is changed.
+ */
+static SearchPattern *
+get_pattern(const char *needle, SearchMode mode, bool force8bit)
+{
+	SearchPattern *sp = &current_pattern;
+
+	if (!sp->is_valid || sp->mode != mode || sp->force8bit != force8bit ||
+		strcmp(sp->needle, needle) != 0)
+		compile_pattern(sp, needle, mode, force8bit);
+
+	return sp;
+}
+
+/*
+ * Returns pointer to first occurrence of needle in haystack or NULL.
+ */
+const char *
+search_pattern(const char *haystack, const char *needle, SearchMode mode, bool force8bit)
+{
+	SearchPattern *sp = get_pattern(needle, mode, force8bit);
+
+	if (sp->use_horspool)
+		return horspool_search(sp, haystack, strlen(haystack));
+
+	if (mode == SEARCH_IGNORE_LOWER_CASE)
+		return utf8_nstrstr_ignore_lower_case(haystack, needle);
+
+	return utf8_nstrstr(haystack, needle);
+}
+
+/*
+ * Returns pointer to first occurrence of needle in first haystack_size
+ * bytes of haystack or NULL.
+ */
+const char *
+search_pattern_bounded(const char *haystack, int haystack_size,
+					   const char *needle, SearchMode mode, bool force8bit)
+{
+	SearchPattern *sp = get_pattern(needle, mode, force8bit);
+
+	if (sp->use_horspool)
+		return horspool_search(sp, haystack, haystack_size);
+
+	if (mode == SEARCH_IGNORE_LOWER_CASE)
+		return utf8_nstrstr_ignore_lower_case_with_sizes(haystack, haystack_size,
+														 needle, sp->size);
+
+	return utf8_nstrstr_with_sizes(haystack, haystack_size, needle, sp->size);
+}
+
+/*
+ * Compiled regular expression. The automaton is created by regcomp, and
+ * it is reused until the pattern is changed. The literal is a string,
+ * that should be in every matched string. It is used for fast rejecting
+ * of rows without possible match.
+ */
+typedef struct
+{
+	char			pattern[256];		/* source pattern */
+	bool			icase;
+	bool			is_valid;
+	bool			is_compiled;		/* false, when pattern is not valid */
+	regex_t			regex;
+	char			literal[256];		/* required literal or empty string */
+} SearchRegex;
+
+static SearchRegex current_regex;
+
+#define REGEX_MAX_REPEAT			100
+
+/*
+ * Returns true, when the char can be quantified by following char
+ */
+static bool
+is_quantifier(const char *str)
+{
+	return *str == '*' || *str == '?' || *str == '+' || *str == '{';
+}
+
+/*
+ * Skip bracket expression. Returns pointer to char after closing bracket.
+ */
+static const char *
+skip_bracket(const char *str)
+{
+	/* skip [ */
+	str += 1;
+
+	if (*str == '^')
+		str += 1;
+
+	/* closing bracket at first position is literal */
+	if (*str == ']')
+		str += 1;
+
+	while (*str && *str != ']')
+	{
+		if (*str == '[' && (str[1] == ':' || str[1] == '.' || str[1] == '='))
+		{
+			char	term = str[1];
+
+			str += 2;
+			while (*str && !(*str == term && str[1] == ']'))
+				str += 1;
+
+			if (*str)
+				str += 2;
+		}
+		else
+			str += 1;
+	}
+
+	return *str ? str + 1 : str;
+}
+
+/*
+ * Finds longest literal, that has to be in every matched string. Only
+ * chars outside of groups are used. When pattern has alternatives, then
+ * there are not any required literal. For case insensitive pattern, only
+ * ascii chars are used (folding of others chars can be different).
+ */
+static void
+extract_literal(const char *pattern, bool icase, char *literal)
+{
+	char	run[256];
+	int		runlen = 0;
+	int		bestlen = 0;
+	int		depth = 0;
+	const char *str = pattern;
+
+	*literal = '\0';
+
+	while (*str)
+	{
+		const char *atom = str;
+		bool	is_literal = false;
+		int		atom_len = 1;
+
+		/* pattern with alternatives has not required literal */
+		if (*str == '|' && depth == 0)
+		{
+			*literal = '\0';
+			return;
+		}
+
+		if (*str == '\\' && str[1] != '\0')
+		{
+			is_literal = depth == 0 && strchr(".[]()*+?{}|^$\\/", str[1]) != NULL;
+			atom = str + 1;
+			str += 2;
+		}
+		else if (*str == '[')
+			str = skip_bracket(str);
+		else if (*str == '(')
+		{
+			depth += 1;
+			str += 1;
+		}
+		else if (*str == ')')
+		{
+			depth -= 1;
+			str += 1;
+		}
+		else if (*str == '{')
+		{
+			/* skip repeating counter */
+			while (*str && *str != '}')
+				str += 1;
+
+			if (*str)
+				str += 1;
+		}
+		else if (strchr(".^$*+?|", *str) != NULL)
+			str += 1;
+		else
+		{
+			int		i;
+
+			atom_len = utf8charlen(*str);
+			for (i = 1; i < atom_len; i++)
+			{
+				if (str[i] == '\0')
+				{
+					atom_len = i;
+					break;
+				}
+			}
+
+			is_literal = depth == 0;
+			str += atom_len;
+		}
+
+		if (is_literal && icase && (unsigned char) *atom >= 0x80)
+			is_literal = false;
+
+		/* quantified atom is not required, or it breaks the literal */
+		if (is_literal && is_quantifier(str))
+		{
+			if (*str == '+')
+			{
+				memcpy(run + runlen, atom, atom_len);
+				runlen += atom_len;
+			}
+
+			is_literal = false;
+		}
+
+		if (is_literal)
+		{
+			memcpy(run + runlen, atom, atom_len);
+			runlen += atom_len;
+		}
+
+		if (!is_literal || *str == '\0')
+		{
+			if (runlen > bestlen)
+			{
+				memcpy(literal, run, runlen);
+				literal[runlen] = '\0';
+				bestlen = runlen;
+			}
+
+			runlen = 0;
+		}
+	}
+}
+
+/*
+ * Returns false, when pattern can be processed too slowly. Back references
+ * force backtracking in regexec, and nested repeating counters produces
+ * very large automaton.
+ */
+static bool
+is_safe_regex(const char *pattern, char *errbuf, int errbuf_size)
+{
+	const char *str = pattern;
+
+	while (*str)
+	{
+		if (*str == '\\' && str[1] != '\0')
+		{
+			if (str[1] >= '1' && str[1] <= '9')
+			{
+				snprintf(errbuf, errbuf_size, "back references are not supported");
+				return false;
+			}
+
+			str += 2;
+		}
+		else if (*str == '[')
+			str = skip_bracket(str);
+		else if (*str == '{')
+		{
+			char   *endptr;
+			long	n;
+
+			str += 1;
+			while (*str && *str != '}')
+			{
+				if (isdigit((unsigned char) *str))
+				{
+					n = strtol(str, &endptr, 10);
+					if (n > REGEX_MAX_REPEAT)
+					{
+						snprintf(errbuf, errbuf_size, "repeat count is greater than %d", REGEX_MAX_REPEAT);
+						return false;
+					}
+
+					str = endptr;
+				}
+				else
+					str += 1;
+			}
+		}
+		else
+			str += 1;
+	}
+
+	return true;
+}
+
+static bool
+compile_regex(SearchRegex *sr, const char *pattern, bool icase, char *errbuf, int errbuf_size)
+{
+	int		result;
+
+	if (sr->is_compiled)
+		regfree(&sr->regex);
+
+	strncpy(sr->pattern, pattern, sizeof(sr->pattern) - 1);
+	sr->pattern[sizeof(sr->pattern) - 1] = '\0';
+
+	sr->icase = icase;
+	sr->is_valid = true;
+	sr->is_compiled = false;
+	sr->literal[0] = '\0';
+
+	if (!is_safe_regex(sr->pattern, errbuf, errbuf_size))
+		return false;
+
+	result = regcomp(&sr->regex, sr->pattern, REG_EXTENDED | (icase ? REG_ICASE : 0));
+	if (result != 0)
+	{
+		if (errbuf)
+			regerror(result, &sr->regex, errbuf, errbuf_size);
+		return false;
+	}
+
+	sr->is_compiled = true;
+
+	/* pattern that matches empty string is not usable for searching */
+	if (regexec(&sr->regex, "", 0, NULL, 0) == 0)
+	{
+		snprintf(errbuf, errbuf_size, "pattern matches empty string");
+		regfree(&sr->regex);
+		sr->is_compiled = false;
+		return false;
+	}
+
+	extract_literal(sr->pattern, icase, sr->literal);
+
+	return true;
+}
+
+/*
+ * Returns true, when the pattern is valid regular expression, that can
+ * be used for searching. Else the reason is written to errbuf.
+ */
+bool
+check_regex(const char *pattern, bool icase, char *errbuf, int errbuf_size)
+{
+	return compile_regex(&current_regex, pattern, icase, errbuf, errbuf_size);
+}
+
+/*
+ * Returns pointer to first match of regular expression in str or NULL.
+ * The str is a part of string begin (it is important for anchors), and
+ * when end is not NULL, then the string ends there. The size of matched
+ * string in bytes is stored to match_size.
+ */
+static const char *
+search_regex_range(const char *begin, const char *str, const char *end,
+				   const char *pattern, bool icase, int *match_size)
+{
+	SearchRegex *sr = &current_regex;
+	SearchMode	mode = icase ? SEARCH_IGNORE_CASE : SEARCH_CASE_SENSITIVE;
+	regmatch_t	match;
+	char		errbuf[256];
+
+	if (!sr->is_valid || sr->icase != icase || strcmp(sr->pattern, pattern) != 0)
+		compile_regex(sr, pattern, icase, errbuf, sizeof(errbuf));
+
+	if (!sr->is_compiled)
+		return NULL;
+
+	if (sr->literal[0] != '\0' &&
+		!(end ? search_pattern_bounded(str, end - str, sr->literal, mode, false) :
+				search_pattern(str, sr->literal, mode, false)))
+		return NULL;
+
+	for (;;)
+	{
+		int		eflags = str != begin ? REG_NOTBOL : 0;
+
+		if (end)
+		{
+			match.rm_so = 0;
+			match.rm_eo = end - str;
+			eflags |= REG_STARTEND;
+		}
+
+		if (regexec(&sr->regex, str, 1, &match, eflags) != 0)
+			return NULL;
+
+		if (match.rm_eo > match.rm_so)
+			break;
+
+		/* empty match is not visible, try to search from next char */
+		str += match.rm_so;
+		if (*str == '\0' || (end && str >= end))
+			return NULL;
+
+		str += utf8charlen(*str);
+	}
+
+	*match_size = match.rm_eo - match.rm_so;
+
+	return str + match.rm_so;
+}
+
+/*
+ * Returns pointer to first match of regular expression in str or NULL.
+ * The str is a part of row rowstr (it is important for anchors). The size
+ * of matched string in bytes is stored to match_size.
+ */
+const char *
+search_regex(const char *rowstr, const char *str, const char *pattern,
+			 bool icase, int *match_size)
+{
+	return search_regex_range(rowstr, str, NULL, pattern, icase, match_size);
+}
+
+/*
+ * Limit searching to column "colno". The searched range is the content
+ * of column between borders. Zero colno means searching in whole rows.
+ */
+void
+set_search_column(ScrDesc *scrdesc, DataDesc *desc, int colno)
+{
+	if (colno > 0 && colno <= desc->columns && desc->cranges)
+	{
+		CRange *cr = &desc->cranges[colno - 1];
+
+		/* first column of table without outer border starts on zero position */
+		if (desc->border_type != 2 && cr->xmin == 0)
+			scrdesc->search_col_minx = 0;
+		else
+			scrdesc->search_col_minx = cr->xmin + 1;
+
+		/* and the last column has not right border */
+		if (desc->border_type != 2 && colno == desc->columns)
+			scrdesc->search_col_maxx = cr->xmax;
+		else
+			scrdesc->search_col_maxx = cr->xmax - 1;
+
+		scrdesc->search_column = colno;
+	}
+	else
+		scrdesc->search_column = 0;
+}
+
+/*
+ * Returns byte offsets of searched column in row. The search starts on
+ * the offsets of columns from column offset index, so only chars near to
+ * borders of column are processed. Returns false, when the row is too
+ * short.
+ */
+static bool
+get_column_range(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				 LineBuffer *lnb, int lnb_row, int *start, int *end)
+{
+	ColumnOffset *offsets = get_column_offsets(opts, desc, lnb, lnb_row);
+	int			colno = scrdesc->search_column;
+	const char *rowstr = lnb->rows[lnb_row];
+	const char *str;
+	int			pos;
+
+	str = rowstr + offsets[colno - 1].offset;
+	pos = offsets[colno - 1].pos;
+
+	while (*str && pos < scrdesc->search_col_minx)
+	{
+		pos += opts->force8bit ? 1 : utf_dsplen(str);
+		str += opts->force8bit ? 1 : utf8charlen(*str);
+	}
+
+	if (*str == '\0')
+		return false;
+
+	*start = str - rowstr;
+
+	/* the end of column is near to begin of next column */
+	if (colno < desc->columns && offsets[colno].offset > *start)
+	{
+		str = rowstr + offsets[colno].offset;
+		pos = offsets[colno].pos;
+	}
+
+	while (*str && pos <= scrdesc->search_col_maxx)
+	{
+		pos += opts->force8bit ? 1 : utf_dsplen(str);
+		str += opts->force8bit ? 1 : utf8charlen(*str);
+	}
+
+	*end = str - rowstr;
+
+	return true;
+}
+
+/*
+ * Search pattern only in selected column. The searching is limited by
+ * the end of column, so the rest of row is not scanned. Returns pointer
+ * to row rowstr like pspg_search. Only rows of data have columns.
+ */
+const char *
+search_in_column(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				 LineBuffer *lnb, int lnb_row,
+				 const char *rowstr, const char *str, int *match_size)
+{
+	SearchMode	mode = pspg_search_mode(opts, scrdesc);
+	int			start, end;
+
+	if (!lnb || rowstr != lnb->rows[lnb_row])
+		return NULL;
+
+	if (!get_column_range(opts, scrdesc, desc, lnb, lnb_row, &start, &end))
+		return NULL;
+
+	if (str - rowstr >= end)
+		return NULL;
+
+	if (str - rowstr < start)
+		str = rowstr + start;
+
+	if (opts->regex_search)
+		return search_regex_range(rowstr + start, str, rowstr + end,
+								  scrdesc->searchterm,
+								  mode == SEARCH_IGNORE_CASE, match_size);
+
+	*match_size = scrdesc->searchterm_size;
+
+	return search_pattern_bounded(str, rowstr + end - str,
+								  scrdesc->searchterm, mode, opts->force8bit);
+}
+
+/*
+ * Search index holds positions of all occurrences of search pattern in
+ * displayed order. It is used for fast navigation between found patterns
+ * and for counting of found patterns.
+ */
+void
+free_search_index(DataDesc *desc)
+{
+	if (desc->search_index)
+	{
+		mem_free(MEM_SEARCH, sizeof(SearchIndex) +
+							 desc->search_index->size * sizeof(SearchMatch));
+
+		free(desc->search_index->matches);
+		free(desc->search_index);
+		desc->search_index = NULL;
+	}
+}
+
+/*
+ * Returns search index for current search term. When the term or search
+ * mode was changed, then the processing of previous pattern is canceled,
+ * and new (empty) index is created. Returns NULL when search term is empty.
+ */
+SearchIndex *
+get_search_index(Options *opts, ScrDesc *scrdesc, DataDesc *desc)
+{
+	SearchIndex *si = desc->search_index;
+	SearchMode	mode;
+
+	if (scrdesc->searchterm_size == 0)
+	{
+		free_search_index(desc);
+		return NULL;
+	}
+
+	mode = pspg_search_mode(opts, scrdesc);
+
+	if (si && si->mode == mode && si->force8bit == opts->force8bit &&
+		si->regex == opts->regex_search &&
+		si->column == scrdesc->search_column &&
+		strcmp(si->needle, scrdesc->searchterm) == 0)
+		return si;
+
+	free_search_index(desc);
+
+	si = malloc(sizeof(SearchIndex));
+	if (!si)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SEARCH, sizeof(SearchIndex));
+
+	memset(si, 0, sizeof(SearchIndex));
+
+	memcpy(si->needle, scrdesc->searchterm, sizeof(si->needle));
+	si->needle[sizeof(si->needle) - 1] = '\0';
+	si->mode = mode;
+	si->force8bit = opts->force8bit;
+	si->regex = opts->regex_search;
+	si->column = scrdesc->search_column;
+
+	/* header rows are not searched */
+	si->next_row = desc->title_rows + desc->fixed_rows;
+
+	si->lnb = &desc->rows;
+	si->lnb_row = si->next_row;
+
+	while (si->lnb && si->lnb_row >= si->lnb->nrows)
+	{
+		si->lnb_row -= si->lnb->nrows;
+		si->lnb = si->lnb->next;
+	}
+
+	desc->search_index = si;
+
+	return si;
+}
+
+static void
+add_search_match(SearchIndex *si, int row, int offset, int size, int start_x, int end_x)
+{
+	if (si->nmatches == si->size)
+	{
+		int		new_size = si->size > 0 ? si->size * 2 : 1024;
+
+		si->matches = realloc(si->matches, new_size * sizeof(SearchMatch));
+		if (!si->matches)
+			leave_ncurses("out of memory");
+
+		mem_alloc(MEM_SEARCH, (new_size - si->size) * sizeof(SearchMatch));
+		si->size = new_size;
+	}
+
+	si->matches[si->nmatches].row = row;
+	si->matches[si->nmatches].offset = offset;
+	si->matches[si->nmatches].size = size;
+	si->matches[si->nmatches].start_x = start_x;
+	si->matches[si->nmatches].end_x = end_x;
+	si->nmatches += 1;
+}
+
+/*
+ * Process next nrows rows. Returns true, when all rows are processed.
+ */
+bool
+search_index_scan(Options *opts, ScrDesc *scrdesc, DataDesc *desc, int nrows)
+{
+	SearchIndex *si = get_search_index(opts, scrdesc, desc);
+
+	if (!si)
+		return true;
+
+	while (!si->is_complete && nrows-- > 0)
+	{
+		LineBuffer *row_lnb;
+		int			row_lnb_row;
+		const char *rowstr;
+		const char *str;
+		const char *prev_end;
+		int			prev_end_x = 0;
+		int			size;
+
+		if (desc->order_map)
+		{
+			MappedLine *mp;
+
+			if (si->next_row >= desc->total_rows - desc->hidden_rows ||
+				(si->column > 0 && si->next_row > desc->last_data_row))
+			{
+				si->is_complete = true;
+				break;
+			}
+
+			mp = &desc->order_map[si->next_row];
+			row_lnb = mp->lnb;
+			row_lnb_row = mp->lnb_row;
+		}
+		else
+		{
+			while (si->lnb && si->lnb_row >= si->lnb->nrows)
+			{
+				si->lnb = si->lnb->next;
+				si->lnb_row = 0;
+			}
+
+			/* only data rows have columns */
+			if (!si->lnb || (si->column > 0 && si->next_row > desc->last_data_row))
+			{
+				si->is_complete = true;
+				break;
+			}
+
+			row_lnb = si->lnb;
+			row_lnb_row = si->lnb_row++;
+		}
+
+		rowstr = row_lnb->rows[row_lnb_row];
+
+		/* the occurrences of pattern are not overlapped */
+		str = prev_end = rowstr;
+		while ((str = pspg_search(opts, scrdesc, desc, row_lnb, row_lnb_row, rowstr, str, &size)) != NULL)
+		{
+			int		start_x, end_x;
+
+			/* char positions are counted from end of previous match */
+			if (opts->force8bit)
+			{
+				start_x = str - rowstr;
+				end_x = start_x + size;
+			}
+			else
+			{
+				start_x = prev_end_x + utf8len_start_stop(prev_end, str);
+				end_x = start_x + utf8len_start_stop(str, str + size);
+			}
+
+			add_search_match(si, si->next_row, str - rowstr, size, start_x, end_x);
+
+			str += size;
+			prev_end = str;
+			prev_end_x = end_x;
+		}
+
+		si->next_row += 1;
+	}
+
+	return si->is_complete;
+}
+
+/*
+ * Returns index of first match on position (row, offset) or after.
+ */
+static int
+search_index_lower_bound(SearchIndex *si, int row, int offset)
+{
+	int		low = 0;
+	int		high = si->nmatches;
+
+	while (low < high)
+	{
+		int		mid = low + (high - low) / 2;
+		SearchMatch *m = &si->matches[mid];
+
+		if (m->row < row || (m->row == row && m->offset < offset))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Returns order (starting by 1) of match on position (row, offset),
+ * or zero, when there is not any match on this position.
+ */
+int
+search_index_position(SearchIndex *si, int row, int offset)
+{
+	int		i = search_index_lower_bound(si, row, offset);
+
+	if (i < si->nmatches && si->matches[i].row == row && si->matches[i].offset == offset)
+		return i + 1;
+
+	return 0;
+}
+
+/*
+ * When the row is processed already, then returns true, and matches
+ * holds the found positions on this row (ordered by offset). So it is
+ * not necessary to search the row again when it is displayed.
+ */
+bool
+search_index_row(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				 int row, SearchMatch **matches, int *nmatches)
+{
+	SearchIndex *si = get_search_index(opts, scrdesc, desc);
+	int		i, j;
+
+	if (!si || (!si->is_complete && row >= si->next_row))
+		return false;
+
+	i = search_index_lower_bound(si, row, 0);
+
+	for (j = i; j < si->nmatches && si->matches[j].row == row; j++)
+		;
+
+	*matches = &si->matches[i];
+	*nmatches = j - i;
+
+	return true;
+}
+
+/*
+ * Bounded searching of first match from row "row" in specified direction.
+ * It doesn't use search index, so it can be used for incremental search
+ * without processing of rows before cursor. The searching is canceled,
+ * when some input is pending on fd, or when the time budget is over.
+ * The pending input is checked after every SEARCH_CHECK_ROWS rows.
+ */
+SearchResult
+search_rows_bounded(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+					int row, bool backward, int fd, int budget_ms,
+					SearchMatch *match)
+{
+	struct timespec start_ts;
+	LineBuffer *lnb = NULL;
+	int			lnb_row = 0;
+	int			first_row = desc->title_rows + desc->fixed_rows;
+	int			last_row;
+	int			nrows = 0;
+
+	if (scrdesc->searchterm_size == 0)
+		return SEARCH_RESULT_NOT_FOUND;
+
+	if (scrdesc->search_column > 0)
+		last_row = desc->last_data_row;
+	else
+		last_row = desc->total_rows - desc->hidden_rows - 1;
+
+	if (!desc->order_map)
+	{
+		lnb = &desc->rows;
+		lnb_row = row;
+
+		while (lnb && lnb_row >= lnb->nrows)
+		{
+			lnb_row -= lnb->nrows;
+			lnb = lnb->next;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start_ts);
+
+	while (row >= first_row && row <= last_row)
+	{
+		LineBuffer *row_lnb;
+		int			row_lnb_row;
+		const char *rowstr;
+		const char *str;
+		const char *found = NULL;
+		int			size;
+		int			found_size = 0;
+
+		if (++nrows % SEARCH_CHECK_ROWS == 0)
+		{
+			struct timespec ts;
+			long		ms;
+
+			if (is_input_pending(fd))
+				return SEARCH_RESULT_CANCELED;
+
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			ms = (ts.tv_sec - start_ts.tv_sec) * 1000 +
+				 (ts.tv_nsec - start_ts.tv_nsec) / 1000000;
+
+			if (ms > budget_ms)
+				return SEARCH_RESULT_TIMEOUT;
+		}
+
+		if (desc->order_map)
+		{
+			MappedLine *mp = &desc->order_map[row];
+
+			row_lnb = mp->lnb;
+			row_lnb_row = mp->lnb_row;
+		}
+		else
+		{
+			if (!lnb)
+				break;
+
+			row_lnb = lnb;
+			row_lnb_row = lnb_row;
+		}
+
+		rowstr = row_lnb->rows[row_lnb_row];
+
+		/* for backward direction, the last match on row is required */
+		str = rowstr;
+		while ((str = pspg_search(opts, scrdesc, desc, row_lnb, row_lnb_row, rowstr, str, &size)) != NULL)
+		{
+			found = str;
+			found_size = size;
+
+			if (!backward)
+				break;
+
+			str += size;
+		}
+
+		if (found)
+		{
+			match->row = row;
+			match->offset = found - rowstr;
+			match->size = found_size;
+
+			if (opts->force8bit)
+			{
+				match->start_x = match->offset;
+				match->end_x = match->offset + found_size;
+			}
+			else
+			{
+				match->start_x = utf8len_start_stop(rowstr, found);
+				match->end_x = match->start_x + utf8len_start_stop(found, found + found_size);
+			}
+
+			return SEARCH_RESULT_FOUND;
+		}
+
+		if (backward)
+		{
+			row -= 1;
+
+			if (lnb && --lnb_row < 0)
+			{
+				lnb = lnb->prev;
+				lnb_row = lnb ? lnb->nrows - 1 : 0;
+			}
+		}
+		else
+		{
+			row += 1;
+
+			if (lnb && ++lnb_row >= lnb->nrows)
+			{
+				lnb = lnb->next;
+				lnb_row = 0;
+			}
+		}
+	}
+
+	return SEARCH_RESULT_NOT_FOUND;
+}
+
+/*
+ * Find first match on position (row, offset) or after, or last match
+ * before this position for backward direction. When the match is found,
+ * then it is stored in scrdesc.
+ */
+bool
+search_index_find(Options *opts, ScrDesc *scrdesc, DataDesc *desc,
+				  int row, int offset, bool backward)
+{
+	SearchIndex *si = get_search_index(opts, scrdesc, desc);
+	SearchMatch *m = NULL;
+	int		i;
+
+	scrdesc->found = false;
+
+	if (!si)
+		return false;
+
+	if (backward)
+	{
+		/* all rows before this position should be processed */
+		while (!si->is_complete && si->next_row <= row)
+			search_index_scan(opts, scrdesc, desc, SEARCH_INDEX_SCAN_ROWS);
+
+		i = search_index_lower_bound(si, row, offset);
+		if (i > 0)
+			m = &si->matches[i - 1];
+	}
+	else
+	{
+		for (;;)
+		{
+			i = search_index_lower_bound(si, row, offset);
+			if (i < si->nmatches)
+			{
+				m = &si->matches[i];
+				break;
+			}
+
+			if (si->is_complete)
+				break;
+
+			search_index_scan(opts, scrdesc, desc, SEARCH_INDEX_SCAN_ROWS);
+		}
+	}
+
+	if (!m)
+		return false;
+
+	scrdesc->found_row = m->row;
+	scrdesc->found_start_bytes = m->offset;
+	scrdesc->found_start_x = m->start_x;
+	scrdesc->found_char_size = m->end_x - m->start_x;
+
+	scrdesc->found = true;
+
+	return true;
+}
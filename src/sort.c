@@ -16,6 +16,70 @@
 
 #include "pspg.h"
 
+typedef int (*sort_compar_fn) (const void *, const void *);
+
+/*
+ * Stable merge sort of SortData. The qsort is not stable, but we need to
+ * hold original order of rows with same values.
+ */
+static void
+merge_sort(SortData *sortbuf, int rows, sort_compar_fn compar)
+{
+	SortData   *src = sortbuf;
+	SortData   *dst;
+	int			width;
+
+	if (rows < 2)
+		return;
+
+	dst = malloc(rows * sizeof(SortData));
+	if (!dst)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SORT, rows * sizeof(SortData));
+
+	for (width = 1; width < rows; width *= 2)
+	{
+		SortData   *aux;
+		int			lo;
+
+		for (lo = 0; lo < rows; lo += 2 * width)
+		{
+			int		mid = lo + width < rows ? lo + width : rows;
+			int		hi = lo + 2 * width < rows ? lo + 2 * width : rows;
+			int		i = lo, j = mid, k = lo;
+
+			while (i < mid && j < hi)
+			{
+				/* take left item when values are same */
+				if (compar(&src[j], &src[i]) < 0)
+					dst[k++] = src[j++];
+				else
+					dst[k++] = src[i++];
+			}
+
+			while (i < mid)
+				dst[k++] = src[i++];
+			while (j < hi)
+				dst[k++] = src[j++];
+		}
+
+		aux = src;
+		src = dst;
+		dst = aux;
+	}
+
+	mem_free(MEM_SORT, rows * sizeof(SortData));
+
+	if (src != sortbuf)
+	{
+		memcpy(sortbuf, src, rows * sizeof(SortData));
+		free(src);
+	}
+	else
+		free(dst);
+}
+
 static int
 compar_num_asc(const void *a, const void *b)
 {
@@ -25,7 +89,7 @@ compar_num_asc(const void *a, const void *b)
 	if (sdb->info == INFO_DOUBLE)
 	{
 		if (sda->info == INFO_DOUBLE)
-			return sda->d - sdb->d;
+			return sda->d < sdb->d ? -1 : (sda->d > sdb->d ? 1 : 0);
 		else
 			return 1;
 	}
@@ -47,7 +111,7 @@ compar_num_desc(const void *a, const void *b)
 	if (sdb->info == INFO_DOUBLE)
 	{
 		if (sda->info == INFO_DOUBLE)
-			return sdb->d - sda->d;
+			return sdb->d < sda->d ? -1 : (sdb->d > sda->d ? 1 : 0);
 		else
 			return 1;
 	}
@@ -63,8 +127,7 @@ compar_num_desc(const void *a, const void *b)
 void
 sort_column_num(SortData *sortbuf, int rows, bool desc)
 {
-
-	qsort(sortbuf, rows, sizeof(SortData), desc ? compar_num_desc : compar_num_asc);
+	merge_sort(sortbuf, rows, desc ? compar_num_desc : compar_num_asc);
 }
 
 static int
@@ -114,5 +177,216 @@ compar_text_desc(const void *a, const void *b)
 void
 sort_column_text(SortData *sortbuf, int rows, bool desc)
 {
-	qsort(sortbuf, rows, sizeof(SortData), desc ? compar_text_desc : compar_text_asc);
+	merge_sort(sortbuf, rows, desc ? compar_text_desc : compar_text_asc);
+}
+
+/*
+ * Compare two rows by ranks of sort keys. Unknown values (rank -1)
+ * are at end for both directions.
+ */
+static int
+compar_ranks(int a, int b, int **ranks, bool *desc, int nkeys)
+{
+	int		i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		int		ra = ranks[i][a];
+		int		rb = ranks[i][b];
+
+		if (ra == rb)
+			continue;
+
+		if (ra == -1)
+			return 1;
+		else if (rb == -1)
+			return -1;
+
+		if (desc[i])
+			return ra < rb ? 1 : -1;
+		else
+			return ra < rb ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Stable sort of row numbers by more sort keys. The "ranks" holds for
+ * every key an array of ranks of values indexed by row number.
+ */
+void
+sort_rows_by_ranks(int *rownums, int rows, int **ranks, bool *desc, int nkeys)
+{
+	int	   *src = rownums;
+	int	   *dst;
+	int		width;
+
+	if (rows < 2)
+		return;
+
+	dst = malloc(rows * sizeof(int));
+	if (!dst)
+		leave_ncurses("out of memory");
+
+	mem_alloc(MEM_SORT, rows * sizeof(int));
+
+	for (width = 1; width < rows; width *= 2)
+	{
+		int	   *aux;
+		int		lo;
+
+		for (lo = 0; lo < rows; lo += 2 * width)
+		{
+			int		mid = lo + width < rows ? lo + width : rows;
+			int		hi = lo + 2 * width < rows ? lo + 2 * width : rows;
+			int		i = lo, j = mid, k = lo;
+
+			while (i < mid && j < hi)
+			{
+				if (compar_ranks(src[j], src[i], ranks, desc, nkeys) < 0)
+					dst[k++] = src[j++];
+				else
+					dst[k++] = src[i++];
+			}
+
+			while (i < mid)
+				dst[k++] = src[i++];
+			while (j < hi)
+				dst[k++] = src[j++];
+		}
+
+		aux = src;
+		src = dst;
+		dst = aux;
+	}
+
+	mem_free(MEM_SORT, rows * sizeof(int));
+
+	if (src != rownums)
+	{
+		memcpy(rownums, src, rows * sizeof(int));
+		free(src);
+	}
+	else
+		free(dst);
+}
+
+/*
+ * Compare two rows in final order. Ties are ordered by original position,
+ * so the result is same like result of stable sort.
+ */
+static int
+compar_sort_data(SortData *a, SortData *b, bool is_string, bool desc)
+{
+	bool	a_known = a->info != INFO_UNKNOWN;
+	bool	b_known = b->info != INFO_UNKNOWN;
+
+	if (a_known && b_known)
+	{
+		int		result;
+
+		if (is_string)
+			result = strcmp(a->strxfrm, b->strxfrm);
+		else
+			result = a->d < b->d ? -1 : (a->d > b->d ? 1 : 0);
+
+		if (result != 0)
+			return desc ? -result : result;
+	}
+	else if (a_known)
+		return -1;
+	else if (b_known)
+		return 1;
+
+	return a->seqno < b->seqno ? -1 : (a->seqno > b->seqno ? 1 : 0);
+}
+
+static void
+heap_sift_down(SortData *sortbuf, int *heap, int size, int pos, bool is_string, bool desc)
+{
+	while (true)
+	{
+		int		largest = pos;
+		int		left = 2 * pos + 1;
+		int		right = 2 * pos + 2;
+		int		aux;
+
+		if (left < size &&
+			compar_sort_data(&sortbuf[heap[left]], &sortbuf[heap[largest]], is_string, desc) > 0)
+			largest = left;
+		if (right < size &&
+			compar_sort_data(&sortbuf[heap[right]], &sortbuf[heap[largest]], is_string, desc) > 0)
+			largest = right;
+
+		if (largest == pos)
+			break;
+
+		aux = heap[pos];
+		heap[pos] = heap[largest];
+		heap[largest] = aux;
+		pos = largest;
+	}
+}
+
+/*
+ * Select first "limit" rows of not sorted data in final order. Only the
+ * selected rows are sorted, so it is much faster than full sort, when we
+ * need only few rows (for first screen). The indexes of selected rows are
+ * stored to "result". Returns number of selected rows.
+ */
+int
+select_top_rows(SortData *sortbuf, int rows, int limit, bool is_string, bool desc, int *result)
+{
+	int		size = 0;
+	int		i;
+
+	if (limit > rows)
+		limit = rows;
+
+	if (limit <= 0)
+		return 0;
+
+	/* the heap holds the worst of selected rows on top */
+	for (i = 0; i < rows; i++)
+	{
+		if (size < limit)
+		{
+			int		pos = size++;
+
+			result[pos] = i;
+
+			/* sift up */
+			while (pos > 0)
+			{
+				int		parent = (pos - 1) / 2;
+				int		aux;
+
+				if (compar_sort_data(&sortbuf[result[pos]], &sortbuf[result[parent]], is_string, desc) <= 0)
+					break;
+
+				aux = result[pos];
+				result[pos] = result[parent];
+				result[parent] = aux;
+				pos = parent;
+			}
+		}
+		else if (compar_sort_data(&sortbuf[i], &sortbuf[result[0]], is_string, desc) < 0)
+		{
+			result[0] = i;
+			heap_sift_down(sortbuf, result, size, 0, is_string, desc);
+		}
+	}
+
+	/* heap sort of selected rows */
+	for (i = size - 1; i > 0; i--)
+	{
+		int		aux = result[0];
+
+		result[0] = result[i];
+		result[i] = aux;
+		heap_sift_down(sortbuf, result, i, 0, is_string, desc);
+	}
+
+	return size;
 }
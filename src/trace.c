@@ -0,0 +1,168 @@
+/*-------------------------------------------------------------------------
+ *
+ * trace.c
+ *	  runtime trace of events saved in Chrome trace-event format
+ *
+ * Portions Copyright (c) 2017-2019 Pavel Stehule
+ *
+ * IDENTIFICATION
+ *	  src/trace.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pspg.h"
+
+/*
+ * Events are stored in ring buffer. When the buffer is full, the oldest
+ * events are overwritten, so the trace holds last TRACE_MAX_EVENTS events.
+ * Only pointers to static strings are stored, so tracing doesn't allocate
+ * memory.
+ */
+#define TRACE_MAX_EVENTS		65536
+
+typedef struct
+{
+	const char *cat;				/* category of event */
+	const char *name;				/* name of event */
+	const char *argname;			/* name of argument or NULL */
+	long		arg;				/* value of argument */
+	long		ts;					/* start of event in us */
+	long		dur;				/* duration in us or -1 for instant event */
+} TraceEvent;
+
+bool		trace_active = false;
+volatile bool trace_dump_requested = false;
+
+static TraceEvent *trace_events = NULL;
+static long trace_nevents = 0;		/* number of all stored events */
+static char *trace_path = NULL;
+static long trace_start_time = 0;
+
+static long
+trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000 - trace_start_time;
+}
+
+/*
+ * Starts tracing. The trace is written to file on exit, or when
+ * it is requested by signal SIGUSR1.
+ */
+void
+trace_init(const char *path)
+{
+	trace_events = malloc(TRACE_MAX_EVENTS * sizeof(TraceEvent));
+	trace_path = strdup(path);
+
+	if (!trace_events || !trace_path)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	trace_start_time = trace_now();
+	trace_active = true;
+
+	atexit(trace_dump);
+}
+
+static void
+add_event(const char *cat, const char *name, long ts, long dur,
+		  const char *argname, long arg)
+{
+	TraceEvent *te = &trace_events[trace_nevents++ % TRACE_MAX_EVENTS];
+
+	te->cat = cat;
+	te->name = name;
+	te->argname = argname;
+	te->arg = arg;
+	te->ts = ts;
+	te->dur = dur;
+}
+
+/*
+ * Returns start time of traced operation (in us), or zero, when
+ * tracing is not active.
+ */
+long
+trace_begin(void)
+{
+	return trace_active ? trace_now() : 0;
+}
+
+/*
+ * Stores event with duration from start (returned by trace_begin) to now.
+ */
+void
+trace_end(const char *cat, const char *name, long start, const char *argname, long arg)
+{
+	if (trace_active)
+		add_event(cat, name, start, trace_now() - start, argname, arg);
+}
+
+void
+trace_instant(const char *cat, const char *name, const char *argname, long arg)
+{
+	if (trace_active)
+		add_event(cat, name, trace_now(), -1, argname, arg);
+}
+
+/*
+ * Writes stored events to file in Chrome trace-event JSON format. The file
+ * can be opened by chrome://tracing or https://ui.perfetto.dev
+ */
+void
+trace_dump(void)
+{
+	FILE	   *fp;
+	long		first;
+	long		i;
+	int			pid = getpid();
+
+	trace_dump_requested = false;
+
+	if (!trace_active)
+		return;
+
+	fp = fopen(trace_path, "w");
+	if (!fp)
+		return;
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+
+	first = trace_nevents > TRACE_MAX_EVENTS ? trace_nevents - TRACE_MAX_EVENTS : 0;
+
+	for (i = first; i < trace_nevents; i++)
+	{
+		TraceEvent *te = &trace_events[i % TRACE_MAX_EVENTS];
+
+		fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":1,\"ts\":%ld,",
+				te->name, te->cat, pid, te->ts);
+
+		if (te->dur >= 0)
+			fprintf(fp, "\"ph\":\"X\",\"dur\":%ld", te->dur);
+		else
+			fprintf(fp, "\"ph\":\"i\",\"s\":\"t\"");
+
+		if (te->argname)
+			fprintf(fp, ",\"args\":{\"%s\":%ld}", te->argname, te->arg);
+
+		fprintf(fp, "}%s\n", i + 1 < trace_nevents ? "," : "");
+	}
+
+	fprintf(fp, "],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"lost_events\":%ld}}\n", first);
+
+	fclose(fp);
+}
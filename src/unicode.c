@@ -13,6 +13,7 @@
 
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "unicode.h"
 #include "string.h"
@@ -238,6 +239,76 @@ ucs_wcwidth(wchar_t ucs)
 		  (ucs >= 0x20000 && ucs <= 0x2ffff)));
 }
 
+/*
+ * Display widths of chars from BMP are stored in two-level table. The
+ * first level (indexed by high byte of char) holds number of page with
+ * widths of 256 chars. Same pages are shared, so only few tens of pages
+ * are used. The table is built from ucs_wcwidth, when it is used first
+ * time. Other chars are calculated by ucs_wcwidth still.
+ */
+#define WIDTH_MAX_PAGES			64
+#define WIDTH_COMPUTE_PAGE		0xFF
+
+static bool width_pages_ready = false;
+static unsigned char width_page_index[256];
+static signed char width_pages[WIDTH_MAX_PAGES][256];
+
+static void
+init_width_pages(void)
+{
+	int		npages = 0;
+	int		hb;
+
+	for (hb = 0; hb < 256; hb++)
+	{
+		signed char page[256];
+		int		i;
+
+		for (i = 0; i < 256; i++)
+			page[i] = ucs_wcwidth((wchar_t) ((hb << 8) + i));
+
+		for (i = 0; i < npages; i++)
+		{
+			if (memcmp(width_pages[i], page, 256) == 0)
+				break;
+		}
+
+		if (i == npages)
+		{
+			/* calculate widths of this page every time, when there is not free page */
+			if (npages == WIDTH_MAX_PAGES)
+			{
+				width_page_index[hb] = WIDTH_COMPUTE_PAGE;
+				continue;
+			}
+
+			memcpy(width_pages[npages++], page, 256);
+		}
+
+		width_page_index[hb] = i;
+	}
+
+	width_pages_ready = true;
+}
+
+static int
+ucs_wcwidth_table(wchar_t ucs)
+{
+	if ((unsigned long) ucs < 0x10000)
+	{
+		int		page;
+
+		if (!width_pages_ready)
+			init_width_pages();
+
+		page = width_page_index[ucs >> 8];
+		if (page != WIDTH_COMPUTE_PAGE)
+			return width_pages[page][ucs & 0xFF];
+	}
+
+	return ucs_wcwidth(ucs);
+}
+
 /*
  * Map a Unicode code point to UTF-8.  utf8string must have 4 bytes of
  * space allocated.
@@ -324,22 +395,80 @@ utf8_to_unicode(const unsigned char *c)
 int
 utf_dsplen(const char *s)
 {
-	return ucs_wcwidth(utf8_to_unicode((const unsigned char *) s));
+	unsigned char c = *s;
+
+	/* fast path for ASCII chars */
+	if (c < 0x80)
+		return (c >= 0x20 && c != 0x7f) ? 1 : (c == 0 ? 0 : -1);
+
+	return ucs_wcwidth_table(utf8_to_unicode((const unsigned char *) s));
+}
+
+#define WORD_ONES		UINT64_C(0x0101010101010101)
+#define WORD_HIGHS		UINT64_C(0x8080808080808080)
+
+/*
+ * Returns true, when all bytes of word are printable ASCII chars
+ * (every char has display width 1).
+ */
+static inline bool
+is_printable_ascii_word(uint64_t w)
+{
+	/* some byte is not ASCII char */
+	if (w & WORD_HIGHS)
+		return false;
+
+	/* some byte is less than 0x20 (control char or zero) */
+	if ((w - 0x20 * WORD_ONES) & ~w & WORD_HIGHS)
+		return false;
+
+	/* some byte is DEL */
+	w ^= 0x7f * WORD_ONES;
+	if ((w - WORD_ONES) & ~w & WORD_HIGHS)
+		return false;
+
+	return true;
 }
 
 /*
  * Returns display length of \0 ended multibyte string.
  * The string is limited by max_bytes too.
+ *
+ * When max_bytes is known length of string (not SIZE_MAX), then printable
+ * ASCII chars are processed by words of 8 bytes. The words are read only
+ * inside of max_bytes.
  */
 int
 utf_string_dsplen(const char *s, size_t max_bytes)
 {
 	int result = 0;
 	const char *ptr = s;
+	bool		use_words = max_bytes != SIZE_MAX;
 
 	while (*ptr != '\0' && max_bytes > 0)
 	{
-		int		clen = utf8charlen(*ptr);
+		int		clen;
+
+		if (use_words && ((uintptr_t) ptr & 7) == 0)
+		{
+			while (max_bytes >= 8)
+			{
+				uint64_t	w;
+
+				memcpy(&w, ptr, 8);
+				if (!is_printable_ascii_word(w))
+					break;
+
+				result += 8;
+				ptr += 8;
+				max_bytes -= 8;
+			}
+
+			if (*ptr == '\0' || max_bytes == 0)
+				break;
+		}
+
+		clen = utf8charlen(*ptr);
 
 		result += utf_dsplen(ptr);
 		ptr += clen;
@@ -494,78 +623,160 @@ find_in_range(range_table *t, size_t size, wchar_t ucs)
 
 #define table_size(t) (sizeof(t)/sizeof((t)[0]))
 
+static struct conv_table tofold_table[] = {
+	{ 0x41, 0x5A, 1, 32 }, { 0xB5, 0xB5, 1, 775 }, { 0xC0, 0xD6, 1, 32 },
+	{ 0xD8, 0xDE, 1, 32 }, { 0x100, 0x12E, 2, 1 }, { 0x132, 0x136, 2, 1 },
+	{ 0x139, 0x147, 2, 1 }, { 0x14A, 0x176, 2, 1 }, { 0x178, 0x178, 1, -121 },
+	{ 0x179, 0x17D, 2, 1 }, { 0x17F, 0x17F, 1, -268 }, { 0x181, 0x181, 1, 210 },
+	{ 0x182, 0x184, 2, 1 }, { 0x186, 0x186, 1, 206 }, { 0x187, 0x187, 1, 1 },
+	{ 0x189, 0x18A, 1, 205 }, { 0x18B, 0x18B, 1, 1 }, { 0x18E, 0x18E, 1, 79 },
+	{ 0x18F, 0x18F, 1, 202 }, { 0x190, 0x190, 1, 203 }, { 0x191, 0x191, 1, 1 },
+	{ 0x193, 0x193, 1, 205 }, { 0x194, 0x194, 1, 207 }, { 0x196, 0x196, 1, 211 },
+	{ 0x197, 0x197, 1, 209 }, { 0x198, 0x198, 1, 1 }, { 0x19C, 0x19C, 1, 211 },
+	{ 0x19D, 0x19D, 1, 213 }, { 0x19F, 0x19F, 1, 214 }, { 0x1A0, 0x1A4, 2, 1 },
+	{ 0x1A6, 0x1A6, 1, 218 }, { 0x1A7, 0x1A7, 1, 1 }, { 0x1A9, 0x1A9, 1, 218 },
+	{ 0x1AC, 0x1AC, 1, 1 }, { 0x1AE, 0x1AE, 1, 218 }, { 0x1AF, 0x1AF, 1, 1 },
+	{ 0x1B1, 0x1B2, 1, 217 }, { 0x1B3, 0x1B5, 2, 1 }, { 0x1B7, 0x1B7, 1, 219 },
+	{ 0x1B8, 0x1BC, 4, 1 }, { 0x1C4, 0x1C4, 1, 2 }, { 0x1C5, 0x1C5, 1, 1 },
+	{ 0x1C7, 0x1C7, 1, 2 }, { 0x1C8, 0x1C8, 1, 1 }, { 0x1CA, 0x1CA, 1, 2 },
+	{ 0x1CB, 0x1DB, 2, 1 }, { 0x1DE, 0x1EE, 2, 1 }, { 0x1F1, 0x1F1, 1, 2 },
+	{ 0x1F2, 0x1F4, 2, 1 }, { 0x1F6, 0x1F6, 1, -97 }, { 0x1F7, 0x1F7, 1, -56 },
+	{ 0x1F8, 0x21E, 2, 1 }, { 0x220, 0x220, 1, -130 }, { 0x222, 0x232, 2, 1 },
+	{ 0x23A, 0x23A, 1, 10795 }, { 0x23B, 0x23B, 1, 1 }, { 0x23D, 0x23D, 1, -163 },
+	{ 0x23E, 0x23E, 1, 10792 }, { 0x241, 0x241, 1, 1 }, { 0x243, 0x243, 1, -195 },
+	{ 0x244, 0x244, 1, 69 }, { 0x245, 0x245, 1, 71 }, { 0x246, 0x24E, 2, 1 },
+	{ 0x345, 0x345, 1, 116 }, { 0x370, 0x372, 2, 1 }, { 0x376, 0x376, 1, 1 },
+	{ 0x37F, 0x37F, 1, 116 }, { 0x386, 0x386, 1, 38 }, { 0x388, 0x38A, 1, 37 },
+	{ 0x38C, 0x38C, 1, 64 }, { 0x38E, 0x38F, 1, 63 }, { 0x391, 0x3A1, 1, 32 },
+	{ 0x3A3, 0x3AB, 1, 32 }, { 0x3C2, 0x3C2, 1, 1 }, { 0x3CF, 0x3CF, 1, 8 },
+	{ 0x3D0, 0x3D0, 1, -30 }, { 0x3D1, 0x3D1, 1, -25 }, { 0x3D5, 0x3D5, 1, -15 },
+	{ 0x3D6, 0x3D6, 1, -22 }, { 0x3D8, 0x3EE, 2, 1 }, { 0x3F0, 0x3F0, 1, -54 },
+	{ 0x3F1, 0x3F1, 1, -48 }, { 0x3F4, 0x3F4, 1, -60 }, { 0x3F5, 0x3F5, 1, -64 },
+	{ 0x3F7, 0x3F7, 1, 1 }, { 0x3F9, 0x3F9, 1, -7 }, { 0x3FA, 0x3FA, 1, 1 },
+	{ 0x3FD, 0x3FF, 1, -130 }, { 0x400, 0x40F, 1, 80 }, { 0x410, 0x42F, 1, 32 },
+	{ 0x460, 0x480, 2, 1 }, { 0x48A, 0x4BE, 2, 1 }, { 0x4C0, 0x4C0, 1, 15 },
+	{ 0x4C1, 0x4CD, 2, 1 }, { 0x4D0, 0x52E, 2, 1 }, { 0x531, 0x556, 1, 48 },
+	{ 0x10A0, 0x10C5, 1, 7264 }, { 0x10C7, 0x10CD, 6, 7264 }, { 0x13F8, 0x13FD, 1, -8 },
+	{ 0x1E00, 0x1E94, 2, 1 }, { 0x1E9B, 0x1E9B, 1, -58 }, { 0x1E9E, 0x1E9E, 1, -7615 },
+	{ 0x1EA0, 0x1EFE, 2, 1 }, { 0x1F08, 0x1F0F, 1, -8 }, { 0x1F18, 0x1F1D, 1, -8 },
+	{ 0x1F28, 0x1F2F, 1, -8 }, { 0x1F38, 0x1F3F, 1, -8 }, { 0x1F48, 0x1F4D, 1, -8 },
+	{ 0x1F59, 0x1F5F, 2, -8 }, { 0x1F68, 0x1F6F, 1, -8 }, { 0x1F88, 0x1F8F, 1, -8 },
+	{ 0x1F98, 0x1F9F, 1, -8 }, { 0x1FA8, 0x1FAF, 1, -8 }, { 0x1FB8, 0x1FB9, 1, -8 },
+	{ 0x1FBA, 0x1FBB, 1, -74 }, { 0x1FBC, 0x1FBC, 1, -9 }, { 0x1FBE, 0x1FBE, 1, -7173 },
+	{ 0x1FC8, 0x1FCB, 1, -86 }, { 0x1FCC, 0x1FCC, 1, -9 }, { 0x1FD8, 0x1FD9, 1, -8 },
+	{ 0x1FDA, 0x1FDB, 1, -100 }, { 0x1FE8, 0x1FE9, 1, -8 }, { 0x1FEA, 0x1FEB, 1, -112 },
+	{ 0x1FEC, 0x1FEC, 1, -7 }, { 0x1FF8, 0x1FF9, 1, -128 }, { 0x1FFA, 0x1FFB, 1, -126 },
+	{ 0x1FFC, 0x1FFC, 1, -9 },{ 0x2126, 0x2126, 1, -7517 }, { 0x212A, 0x212A, 1, -8383 },
+	{ 0x212B, 0x212B, 1, -8262 }, { 0x2132, 0x2132, 1, 28 }, { 0x2160, 0x216F, 1, 16 },
+	{ 0x2183, 0x2183, 1, 1 }, { 0x24B6, 0x24CF, 1, 26 }, { 0x2C00, 0x2C2E, 1, 48 },
+	{ 0x2C60, 0x2C60, 1, 1 }, { 0x2C62, 0x2C62, 1, -10743 }, { 0x2C63, 0x2C63, 1, -3814 },
+	{ 0x2C64, 0x2C64, 1, -10727 }, { 0x2C67, 0x2C6B, 2, 1 }, { 0x2C6D, 0x2C6D, 1, -10780 },
+	{ 0x2C6E, 0x2C6E, 1, -10749 }, { 0x2C6F, 0x2C6F, 1, -10783 }, { 0x2C70, 0x2C70, 1, -10782 },
+	{ 0x2C72, 0x2C75, 3, 1 },{ 0x2C7E, 0x2C7F, 1, -10815 }, { 0x2C80, 0x2CE2, 2, 1 },
+	{ 0x2CEB, 0x2CED, 2, 1 }, { 0x2CF2, 0xA640, 31054, 1 }, { 0xA642, 0xA66C, 2, 1 },
+	{ 0xA680, 0xA69A, 2, 1 }, { 0xA722, 0xA72E, 2, 1 }, { 0xA732, 0xA76E, 2, 1 },
+	{ 0xA779, 0xA77B, 2, 1 }, { 0xA77D, 0xA77D, 1, -35332 }, { 0xA77E, 0xA786, 2, 1 },
+	{ 0xA78B, 0xA78B, 1, 1 }, { 0xA78D, 0xA78D, 1, -42280 }, { 0xA790, 0xA792, 2, 1 },
+	{ 0xA796, 0xA7A8, 2, 1 }, { 0xA7AA, 0xA7AA, 1, -42308 }, { 0xA7AB, 0xA7AB, 1, -42319 },
+	{ 0xA7AC, 0xA7AC, 1, -42315 },{ 0xA7AD, 0xA7AD, 1, -42305 }, { 0xA7B0, 0xA7B0, 1, -42258 },
+	{ 0xA7B1, 0xA7B1, 1, -42282 }, { 0xA7B2, 0xA7B2, 1, -42261 }, { 0xA7B3, 0xA7B3, 1, 928 },
+	{ 0xA7B4, 0xA7B6, 2, 1 }, { 0xAB70, 0xABBF, 1, -38864 }, { 0xFF21, 0xFF3A, 1, 32 }
+
+#if __WCHAR_MAX__ > 0x10000
+
+	, { 0x10400, 0x10427, 1, 40 }, { 0x10C80, 0x10CB2, 1, 64 }, { 0x118A0, 0x118BF, 1, 32 }
+
+#endif
+
+};
+
+/*
+ * Two level direct lookup table for case folding of BMP chars. The first
+ * level is indexed by high byte of char, and it holds number of page
+ * (zero is used for pages without any foldable char). The pages are
+ * filled from tofold_table on first usage.
+ */
+#define TOFOLD_MAX_PAGES		32
+#define TOFOLD_SEARCH_PAGE		0xFF
+
+static bool tofold_pages_ready = false;
+static unsigned char tofold_page_index[256];
+static unsigned short tofold_pages[TOFOLD_MAX_PAGES][256];
+
+static void
+init_tofold_pages(void)
+{
+	int		npages = 0;
+	size_t	i;
+
+	memset(tofold_page_index, 0, sizeof(tofold_page_index));
+
+	for (i = 0; i < table_size(tofold_table); i++)
+	{
+		wchar_t		ucs;
+
+		for (ucs = tofold_table[i].first;
+			 ucs <= tofold_table[i].last && ucs < 0x10000;
+			 ucs += tofold_table[i].step)
+		{
+			int		hb = ucs >> 8;
+			int		folded = ucs + tofold_table[i].offset;
+
+			if (tofold_page_index[hb] == TOFOLD_SEARCH_PAGE)
+				continue;
+
+			/* use binary search for this page, when direct mapping is not possible */
+			if (folded < 0 || folded > 0xFFFF ||
+				(tofold_page_index[hb] == 0 && npages == TOFOLD_MAX_PAGES))
+			{
+				tofold_page_index[hb] = TOFOLD_SEARCH_PAGE;
+				continue;
+			}
+
+			if (tofold_page_index[hb] == 0)
+			{
+				int		j;
+
+				for (j = 0; j < 256; j++)
+					tofold_pages[npages][j] = (hb << 8) + j;
+
+				tofold_page_index[hb] = ++npages;
+			}
+
+			tofold_pages[tofold_page_index[hb] - 1][ucs & 0xFF] = folded;
+		}
+	}
+
+	tofold_pages_ready = true;
+}
+
 int
 utf8_tofold(const char *s)
 {
-	static struct conv_table tofold_table[] = {
-		{ 0x41, 0x5A, 1, 32 }, { 0xB5, 0xB5, 1, 775 }, { 0xC0, 0xD6, 1, 32 },
-		{ 0xD8, 0xDE, 1, 32 }, { 0x100, 0x12E, 2, 1 }, { 0x132, 0x136, 2, 1 },
-		{ 0x139, 0x147, 2, 1 }, { 0x14A, 0x176, 2, 1 }, { 0x178, 0x178, 1, -121 },
-		{ 0x179, 0x17D, 2, 1 }, { 0x17F, 0x17F, 1, -268 }, { 0x181, 0x181, 1, 210 },
-		{ 0x182, 0x184, 2, 1 }, { 0x186, 0x186, 1, 206 }, { 0x187, 0x187, 1, 1 },
-		{ 0x189, 0x18A, 1, 205 }, { 0x18B, 0x18B, 1, 1 }, { 0x18E, 0x18E, 1, 79 },
-		{ 0x18F, 0x18F, 1, 202 }, { 0x190, 0x190, 1, 203 }, { 0x191, 0x191, 1, 1 },
-		{ 0x193, 0x193, 1, 205 }, { 0x194, 0x194, 1, 207 }, { 0x196, 0x196, 1, 211 },
-		{ 0x197, 0x197, 1, 209 }, { 0x198, 0x198, 1, 1 }, { 0x19C, 0x19C, 1, 211 },
-		{ 0x19D, 0x19D, 1, 213 }, { 0x19F, 0x19F, 1, 214 }, { 0x1A0, 0x1A4, 2, 1 },
-		{ 0x1A6, 0x1A6, 1, 218 }, { 0x1A7, 0x1A7, 1, 1 }, { 0x1A9, 0x1A9, 1, 218 },
-		{ 0x1AC, 0x1AC, 1, 1 }, { 0x1AE, 0x1AE, 1, 218 }, { 0x1AF, 0x1AF, 1, 1 },
-		{ 0x1B1, 0x1B2, 1, 217 }, { 0x1B3, 0x1B5, 2, 1 }, { 0x1B7, 0x1B7, 1, 219 },
-		{ 0x1B8, 0x1BC, 4, 1 }, { 0x1C4, 0x1C4, 1, 2 }, { 0x1C5, 0x1C5, 1, 1 },
-		{ 0x1C7, 0x1C7, 1, 2 }, { 0x1C8, 0x1C8, 1, 1 }, { 0x1CA, 0x1CA, 1, 2 },
-		{ 0x1CB, 0x1DB, 2, 1 }, { 0x1DE, 0x1EE, 2, 1 }, { 0x1F1, 0x1F1, 1, 2 },
-		{ 0x1F2, 0x1F4, 2, 1 }, { 0x1F6, 0x1F6, 1, -97 }, { 0x1F7, 0x1F7, 1, -56 },
-		{ 0x1F8, 0x21E, 2, 1 }, { 0x220, 0x220, 1, -130 }, { 0x222, 0x232, 2, 1 },
-		{ 0x23A, 0x23A, 1, 10795 }, { 0x23B, 0x23B, 1, 1 }, { 0x23D, 0x23D, 1, -163 },
-		{ 0x23E, 0x23E, 1, 10792 }, { 0x241, 0x241, 1, 1 }, { 0x243, 0x243, 1, -195 },
-		{ 0x244, 0x244, 1, 69 }, { 0x245, 0x245, 1, 71 }, { 0x246, 0x24E, 2, 1 },
-		{ 0x345, 0x345, 1, 116 }, { 0x370, 0x372, 2, 1 }, { 0x376, 0x376, 1, 1 },
-		{ 0x37F, 0x37F, 1, 116 }, { 0x386, 0x386, 1, 38 }, { 0x388, 0x38A, 1, 37 },
-		{ 0x38C, 0x38C, 1, 64 }, { 0x38E, 0x38F, 1, 63 }, { 0x391, 0x3A1, 1, 32 },
-		{ 0x3A3, 0x3AB, 1, 32 }, { 0x3C2, 0x3C2, 1, 1 }, { 0x3CF, 0x3CF, 1, 8 },
-		{ 0x3D0, 0x3D0, 1, -30 }, { 0x3D1, 0x3D1, 1, -25 }, { 0x3D5, 0x3D5, 1, -15 },
-		{ 0x3D6, 0x3D6, 1, -22 }, { 0x3D8, 0x3EE, 2, 1 }, { 0x3F0, 0x3F0, 1, -54 },
-		{ 0x3F1, 0x3F1, 1, -48 }, { 0x3F4, 0x3F4, 1, -60 }, { 0x3F5, 0x3F5, 1, -64 },
-		{ 0x3F7, 0x3F7, 1, 1 }, { 0x3F9, 0x3F9, 1, -7 }, { 0x3FA, 0x3FA, 1, 1 },
-		{ 0x3FD, 0x3FF, 1, -130 }, { 0x400, 0x40F, 1, 80 }, { 0x410, 0x42F, 1, 32 },
-		{ 0x460, 0x480, 2, 1 }, { 0x48A, 0x4BE, 2, 1 }, { 0x4C0, 0x4C0, 1, 15 },
-		{ 0x4C1, 0x4CD, 2, 1 }, { 0x4D0, 0x52E, 2, 1 }, { 0x531, 0x556, 1, 48 },
-		{ 0x10A0, 0x10C5, 1, 7264 }, { 0x10C7, 0x10CD, 6, 7264 }, { 0x13F8, 0x13FD, 1, -8 },
-		{ 0x1E00, 0x1E94, 2, 1 }, { 0x1E9B, 0x1E9B, 1, -58 }, { 0x1E9E, 0x1E9E, 1, -7615 },
-		{ 0x1EA0, 0x1EFE, 2, 1 }, { 0x1F08, 0x1F0F, 1, -8 }, { 0x1F18, 0x1F1D, 1, -8 },
-		{ 0x1F28, 0x1F2F, 1, -8 }, { 0x1F38, 0x1F3F, 1, -8 }, { 0x1F48, 0x1F4D, 1, -8 },
-		{ 0x1F59, 0x1F5F, 2, -8 }, { 0x1F68, 0x1F6F, 1, -8 }, { 0x1F88, 0x1F8F, 1, -8 },
-		{ 0x1F98, 0x1F9F, 1, -8 }, { 0x1FA8, 0x1FAF, 1, -8 }, { 0x1FB8, 0x1FB9, 1, -8 },
-		{ 0x1FBA, 0x1FBB, 1, -74 }, { 0x1FBC, 0x1FBC, 1, -9 }, { 0x1FBE, 0x1FBE, 1, -7173 },
-		{ 0x1FC8, 0x1FCB, 1, -86 }, { 0x1FCC, 0x1FCC, 1, -9 }, { 0x1FD8, 0x1FD9, 1, -8 },
-		{ 0x1FDA, 0x1FDB, 1, -100 }, { 0x1FE8, 0x1FE9, 1, -8 }, { 0x1FEA, 0x1FEB, 1, -112 },
-		{ 0x1FEC, 0x1FEC, 1, -7 }, { 0x1FF8, 0x1FF9, 1, -128 }, { 0x1FFA, 0x1FFB, 1, -126 },
-		{ 0x1FFC, 0x1FFC, 1, -9 },{ 0x2126, 0x2126, 1, -7517 }, { 0x212A, 0x212A, 1, -8383 },
-		{ 0x212B, 0x212B, 1, -8262 }, { 0x2132, 0x2132, 1, 28 }, { 0x2160, 0x216F, 1, 16 },
-		{ 0x2183, 0x2183, 1, 1 }, { 0x24B6, 0x24CF, 1, 26 }, { 0x2C00, 0x2C2E, 1, 48 },
-		{ 0x2C60, 0x2C60, 1, 1 }, { 0x2C62, 0x2C62, 1, -10743 }, { 0x2C63, 0x2C63, 1, -3814 },
-		{ 0x2C64, 0x2C64, 1, -10727 }, { 0x2C67, 0x2C6B, 2, 1 }, { 0x2C6D, 0x2C6D, 1, -10780 },
-		{ 0x2C6E, 0x2C6E, 1, -10749 }, { 0x2C6F, 0x2C6F, 1, -10783 }, { 0x2C70, 0x2C70, 1, -10782 },
-		{ 0x2C72, 0x2C75, 3, 1 },{ 0x2C7E, 0x2C7F, 1, -10815 }, { 0x2C80, 0x2CE2, 2, 1 },
-		{ 0x2CEB, 0x2CED, 2, 1 }, { 0x2CF2, 0xA640, 31054, 1 }, { 0xA642, 0xA66C, 2, 1 },
-		{ 0xA680, 0xA69A, 2, 1 }, { 0xA722, 0xA72E, 2, 1 }, { 0xA732, 0xA76E, 2, 1 },
-		{ 0xA779, 0xA77B, 2, 1 }, { 0xA77D, 0xA77D, 1, -35332 }, { 0xA77E, 0xA786, 2, 1 },
-		{ 0xA78B, 0xA78B, 1, 1 }, { 0xA78D, 0xA78D, 1, -42280 }, { 0xA790, 0xA792, 2, 1 },
-		{ 0xA796, 0xA7A8, 2, 1 }, { 0xA7AA, 0xA7AA, 1, -42308 }, { 0xA7AB, 0xA7AB, 1, -42319 },
-		{ 0xA7AC, 0xA7AC, 1, -42315 },{ 0xA7AD, 0xA7AD, 1, -42305 }, { 0xA7B0, 0xA7B0, 1, -42258 },
-		{ 0xA7B1, 0xA7B1, 1, -42282 }, { 0xA7B2, 0xA7B2, 1, -42261 }, { 0xA7B3, 0xA7B3, 1, 928 },
-		{ 0xA7B4, 0xA7B6, 2, 1 }, { 0xAB70, 0xABBF, 1, -38864 }, { 0xFF21, 0xFF3A, 1, 32 }
+	const unsigned char *c = (const unsigned char *) s;
+	wchar_t		ucs;
 
-#if __WCHAR_MAX__ > 0x10000
+	/* fast path for ascii chars, there is not necessary any decoding */
+	if (*c < 0x80)
+		return (*c >= 'A' && *c <= 'Z') ? *c + 32 : *c;
 
-		, { 0x10400, 0x10427, 1, 40 }, { 0x10C80, 0x10CB2, 1, 64 }, { 0x118A0, 0x118BF, 1, 32 }
+	ucs = utf8_to_unicode(c);
 
-#endif
+	if (ucs < 0x10000)
+	{
+		int		page;
 
-	};
+		if (!tofold_pages_ready)
+			init_tofold_pages();
 
-	return convert_char(tofold_table, table_size(tofold_table),
-						  utf8_to_unicode((const unsigned char *) s));
+		page = tofold_page_index[ucs >> 8];
+		if (page == 0)
+			return ucs;
+		else if (page != TOFOLD_SEARCH_PAGE)
+			return tofold_pages[page - 1][ucs & 0xFF];
+	}
+
+	return convert_char(tofold_table, table_size(tofold_table), ucs);
 }
 
 const char *
@@ -663,6 +874,8 @@ utf8_nstrstr_ignore_lower_case(const char *haystack, const char *needle)
 {
 	const char *haystack_cur, *needle_cur, *needle_prev;
 	int		f1 = 0, f2 = 0;
+	int		needle_char_len = 0;
+	bool	needle_char_is_upper = false;
 	bool	eq;
 
 	needle_cur = needle;
@@ -672,8 +885,6 @@ utf8_nstrstr_ignore_lower_case(const char *haystack, const char *needle)
 	while (*needle_cur != '\0')
 	{
 		int		haystack_char_len;
-		int		needle_char_len = 0;
-		bool	needle_char_is_upper =  false;
 
 		if (*haystack_cur == '\0')
 			return NULL;
@@ -718,6 +929,77 @@ utf8_nstrstr_ignore_lower_case(const char *haystack, const char *needle)
 	return haystack;
 }
 
+/*
+ * Same like utf8_nstrstr_ignore_lower_case, but the haystack and needle
+ * are limited by sizes.
+ */
+const char *
+utf8_nstrstr_ignore_lower_case_with_sizes(const char *haystack,
+										  int haystack_size,
+										  const char *needle,
+										  int needle_size)
+{
+	const char *haystack_cur, *needle_cur, *needle_prev;
+	const char *haystack_end, *needle_end;
+	int		f1 = 0, f2 = 0;
+	int		needle_char_len = 0;
+	bool	needle_char_is_upper = false;
+	bool	eq;
+
+	needle_cur = needle;
+	needle_prev = NULL;
+	haystack_cur = haystack;
+
+	haystack_end = haystack + haystack_size;
+	needle_end = needle + needle_size;
+
+	while (needle_cur < needle_end)
+	{
+		int		haystack_char_len;
+
+		if (haystack_cur >= haystack_end)
+			return NULL;
+
+		haystack_char_len = utf8charlen(*haystack_cur);
+
+		if (needle_prev != needle_cur)
+		{
+			needle_prev = needle_cur;
+			needle_char_len = utf8charlen(*needle_cur);
+			needle_char_is_upper = utf8_isupper(needle_cur);
+			f1 = utf8_tofold(needle_cur);
+		}
+
+		if (needle_char_is_upper)
+		{
+			/* case sensitive */
+			if (needle_char_len == haystack_char_len)
+				eq = memcmp(haystack_cur, needle_cur, needle_char_len) == 0;
+			else
+				eq = false;
+		}
+		else
+		{
+			/* case insensitive */
+			f2 = utf8_tofold(haystack_cur);
+			eq = f1 == f2;
+		}
+
+		if (eq)
+		{
+			needle_cur += needle_char_len;
+			haystack_cur += haystack_char_len;
+		}
+		else
+		{
+			needle_cur = needle;
+			haystack_cur = haystack += utf8charlen(*haystack);
+		}
+	}
+
+	return haystack;
+}
+
 bool
 utf8_isupper(const char *s)
 {
@@ -779,6 +1061,10 @@ utf8_isupper(const char *s)
 
 	};
 
+	/* fast path for ascii chars */
+	if ((unsigned char) *s < 0x80)
+		return *s >= 'A' && *s <= 'Z';
+
 	return find_in_range(upper_table, table_size(upper_table),
 						utf8_to_unicode((const unsigned char *) s)) != 0;
 }
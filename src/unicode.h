@@ -26,6 +26,7 @@ extern int readline_utf_string_dsplen(const char *s, size_t max_bytes, size_t of
 extern const char *utf8_nstrstr(const char *haystack, const char *needle);
 extern const char *utf8_nstrstr_with_sizes(const char *haystack, int haystack_size, const char *needle, int needle_size);
 extern const char *utf8_nstrstr_ignore_lower_case(const char *haystack, const char *needle);
+extern const char *utf8_nstrstr_ignore_lower_case_with_sizes(const char *haystack, int haystack_size, const char *needle, int needle_size);
 extern bool utf8_isupper(const char *s);
 extern unsigned char *unicode_to_utf8(wchar_t c, unsigned char *utf8string, int *size);
 extern int utf8_tofold(const char *s);